@@ -0,0 +1,749 @@
+#include "analysis.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "dbreader.h"
+#include "getsave.h"
+#include "gvas.h"
+#include "imagevfs.h"
+#include "profile.h"
+#include "tokens.h"
+#include "workers.h"
+
+#define CATALOG_KEYS_TABLE "temp.LegilimensKeys"
+
+bool findDB(std::string_view saveData, std::string_view &dbData, std::vector<std::string> &errors) {
+    // Find the DB through the save's properties
+    GvasIndex index;
+    if (indexGvas(saveData, index) && getGvasByteArray(saveData, index, DB_IMAGE_STR, dbData)) return true;
+    // Fall back to searching for the DB if the properties couldn't be read
+    std::size_t found = saveData.find(DB_IMAGE_STR);
+    if (found == std::string::npos || found + 65 >= saveData.length()) {
+        errors.emplace_back("Legilimens was unable to find the SQL database in your save file");
+        return false;
+    }
+    unsigned long long dbStartIndex = found + 65;
+    unsigned int dbSize = readU32(saveData, dbStartIndex-4);
+    // Point at the DB without copying it
+    dbData = saveData.substr(dbStartIndex, dbSize);
+    return true;
+}
+
+bool extractDB(const std::filesystem::path &saveFile, SaveCache &cache, SaveFile &save, std::string_view &dbData, std::vector<std::string> &errors) {
+    ProfileSpan span("save", "extractDB", saveFile);
+    // Check file existence
+    if (!std::filesystem::exists(saveFile)) {
+        errors.push_back("Legilimens was not able to find the file \"" + saveFile.string() + "\"");
+        return false;
+    }
+    // Map or read the file
+    if (!save.open(saveFile)) {
+        errors.push_back("Legilimens encountered an error reading the file \"" + saveFile.string() + "\"");
+        return false;
+    }
+    std::string_view saveData = save.data();
+    // Check magic header
+    if (!saveData.starts_with(MAGIC_HEADER)) {
+        errors.push_back("File \"" + saveFile.string() + "\" doesn't seem to be a Hogwarts Legacy save file");
+        return false;
+    }
+    // Use the DB's location from the save cache if the save hasn't changed since it was cached
+    SaveInfo info;
+    std::error_code ec;
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(saveFile, ec);
+    if (!ec && cache.find(saveFile, save.fileSize(), time, info) && info.dbOffset > 0 && info.dbOffset <= saveData.length() &&
+        info.dbSize <= saveData.length() - info.dbOffset && saveData.substr(info.dbOffset).starts_with(SQLITE_HEADER)) {
+        dbData = saveData.substr(info.dbOffset, info.dbSize);
+        return true;
+    }
+    return findDB(saveData, dbData, errors);
+}
+
+namespace {
+    // A single read of one SQLite table, answering every query on that table
+    struct TableScan {
+        std::vector<int> queries; // Indices into tables
+        std::string sql;
+        std::string keysSql; // Only returns collectible keys where the queries allow it, see loadCatalogKeys
+    };
+
+    // Gets the condition of a query, optionally limited to the keys of collectibles. Empty if every row matches
+    std::string getQueryCondition(const QueryStruct &query, bool filterKeys) {
+        std::string condition(query.condition);
+        if (!filterKeys || !query.keysOnly) return condition;
+        std::string keyCondition = std::string(query.column) + " IN (SELECT Key FROM " CATALOG_KEYS_TABLE ")";
+        return condition.empty() ? keyCondition : condition + " AND " + keyCondition;
+    }
+
+    // Builds the SQL of a scan. A single query is run as it is, several queries select each of their columns
+    // followed by whether the row matches their condition, out of the rows that match any of them
+    std::string getScanSql(const std::vector<int> &queries, bool filterKeys) {
+        const QueryStruct &first = tables[queries[0]];
+        if (queries.size() == 1) {
+            std::string condition = getQueryCondition(first, filterKeys);
+            std::string sql = "SELECT " + std::string(first.column) + " FROM " + std::string(first.table);
+            if (!condition.empty()) sql += " WHERE " + condition;
+            return sql + ";";
+        }
+        std::string columns, conditions;
+        bool filtered = true;
+        for (int index : queries) {
+            const QueryStruct &query = tables[index];
+            std::string condition = getQueryCondition(query, filterKeys);
+            if (!columns.empty()) columns += ", ";
+            columns += std::string(query.column) + ", " + (condition.empty() ? "1" : "(" + condition + ")");
+            if (condition.empty()) filtered = false;
+            if (!conditions.empty()) conditions += " OR ";
+            conditions += "(" + condition + ")";
+        }
+        return "SELECT " + columns + " FROM " + std::string(first.table) + (filtered ? " WHERE " + conditions : "") + ";";
+    }
+
+    // Groups the queries by table, so that each table in the database is read at most once
+    std::vector<TableScan> planScans() {
+        std::vector<TableScan> plan;
+        std::unordered_map<std::string_view, std::size_t> scanOfTable;
+        for (int i = 0; i < tables.size(); i++) {
+            auto [found, added] = scanOfTable.try_emplace(tables[i].table, plan.size());
+            if (added) plan.emplace_back();
+            plan[found->second].queries.push_back(i);
+        }
+        for (auto &scan : plan) {
+            scan.sql = getScanSql(scan.queries, false);
+            scan.keysSql = getScanSql(scan.queries, true);
+        }
+        return plan;
+    }
+
+    const std::vector<TableScan> &getQueryPlan() {
+        static const std::vector<TableScan> plan = planScans();
+        return plan;
+    }
+
+    // Adds a single value to a query's results, which marks the collectible it's the key of as found
+    // keysOnly queries are only ever looked up by collectible, so their values aren't kept
+    void addQueryValue(int index, std::string_view value, QueryResults &results) {
+        int collectible = findCollectible(CollectibleKeyView(value));
+        if (collectible >= 0) results.collectibles[index].set(collectible);
+        if (!tables[index].keysOnly) results.values[index].emplace(value);
+    }
+
+    // Adds a value returned by a query to its results
+    void addQueryResult(int index, std::string_view value, QueryResults &results) {
+        if (!tables[index].oneRow) {
+            addQueryValue(index, value, results);
+            return;
+        }
+        // Each row is a comma separated list of entries rather than one entry
+        Tokenizer entries(value, isWordChar);
+        std::string_view entry;
+        while (entries.next(entry)) addQueryValue(index, entry, results);
+    }
+
+    // A SQLite connection that's kept open between saves, along with its prepared statements and the catalog keys table,
+    // so they're created once per connection instead of once per save.
+    // Each save's database is attached to it as "save" and detached afterwards. Queries don't name a schema, so SQLite
+    // finds their tables in whichever database is attached.
+    // Attaching a database changes the connection's schema, so SQLite still recompiles cached statements the first time
+    // they run on each save. What's saved is opening the connection, loading the catalog keys, and allocating statements
+    class QueryConnection {
+    public:
+        QueryConnection() = default;
+        QueryConnection(const QueryConnection &) = delete;
+        QueryConnection &operator=(const QueryConnection &) = delete;
+
+        ~QueryConnection() {
+            close();
+        }
+
+        // Attaches the database at uri (see getDBUri), and returns whether it was successful. dbData must stay valid until detach
+        bool attach(const std::string &uri, std::string_view dbData, DBMode dbMode) {
+            ProfileSpan span("sqlite", "attach");
+            if (uri.empty() || (db == nullptr && !connect())) return false;
+            sqlite3_stmt *stmt = statement("ATTACH ? AS save;");
+            if (stmt != nullptr) {
+                sqlite3_bind_text(stmt, 1, uri.c_str(), static_cast<int>(uri.length()), SQLITE_TRANSIENT);
+                attached = sqlite3_step(stmt) == SQLITE_DONE;
+                sqlite3_reset(stmt);
+                sqlite3_clear_bindings(stmt);
+            }
+            // The database is read straight from dbData with sqlite3_deserialize, replacing the empty one that was attached
+            bool success = attached;
+            if (success && dbMode == MemoryDB) {
+                auto *data = reinterpret_cast<unsigned char *>(const_cast<char *>(dbData.data()));
+                auto size = static_cast<sqlite3_int64>(dbData.size());
+                success = sqlite3_deserialize(db, "save", data, size, size, SQLITE_DESERIALIZE_READONLY) == SQLITE_OK;
+            }
+            if (!success) detach();
+            return success;
+        }
+
+        // Detaches the save's database, keeping the connection open for the next one
+        void detach() {
+            if (attached) {
+                sqlite3_stmt *stmt = statement("DETACH save;");
+                bool detached = stmt != nullptr && sqlite3_step(stmt) == SQLITE_DONE;
+                if (stmt != nullptr) sqlite3_reset(stmt);
+                attached = false;
+                // Start over with a new connection rather than risk reading the wrong database
+                if (!detached) close();
+            }
+        }
+
+        // Gets the statement for sql, prepared the first time it's needed. nullptr if it couldn't be prepared
+        sqlite3_stmt *statement(const std::string &sql) {
+            auto found = statements.find(sql);
+            if (found != statements.end()) return found->second;
+            sqlite3_stmt *stmt = nullptr;
+            if (sqlite3_prepare_v3(db, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK) {
+                sqlite3_finalize(stmt);
+                return nullptr;
+            }
+            statements[sql] = stmt;
+            return stmt;
+        }
+
+        // Whether queries can be limited to the keys of collectibles, see loadCatalogKeys
+        bool filterKeys() const {
+            return keysLoaded;
+        }
+
+    private:
+        sqlite3 *db = nullptr;
+        std::unordered_map<std::string, sqlite3_stmt *> statements;
+        bool attached = false;
+        bool keysLoaded = false;
+
+        // Opens the connection, to an empty in-memory main database that saves are attached next to
+        bool connect() {
+            ProfileSpan span("sqlite", "connect");
+            if (sqlite3_open_v2(":memory:", &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI, nullptr) != SQLITE_OK) {
+                close();
+                return false;
+            }
+            keysLoaded = loadCatalogKeys();
+            return true;
+        }
+
+        void close() {
+            for (auto &[sql, stmt] : statements) sqlite3_finalize(stmt);
+            statements.clear();
+            sqlite3_close(db);
+            db = nullptr;
+            attached = false;
+            keysLoaded = false;
+        }
+
+        // Loads the key of every collectible into a temporary table, so queries can skip rows that would never be looked up
+        // Returns whether it was successful, the queries have to return every row otherwise
+        bool loadCatalogKeys() {
+            if (sqlite3_exec(db, "PRAGMA temp_store=MEMORY; CREATE TEMP TABLE LegilimensKeys(Key TEXT PRIMARY KEY) WITHOUT ROWID; BEGIN;",
+                             nullptr, nullptr, nullptr) != SQLITE_OK) return false;
+            sqlite3_stmt *stmt = nullptr;
+            bool success = sqlite3_prepare_v2(db, "INSERT OR IGNORE INTO " CATALOG_KEYS_TABLE " VALUES(?);", -1, &stmt, nullptr) == SQLITE_OK;
+            for (auto collectible = collectibles.begin(); success && collectible != collectibles.end(); collectible++) {
+                sqlite3_bind_text(stmt, 1, collectible->key.text.data(), static_cast<int>(collectible->key.text.length()), SQLITE_STATIC);
+                success = sqlite3_step(stmt) == SQLITE_DONE && sqlite3_reset(stmt) == SQLITE_OK;
+            }
+            sqlite3_finalize(stmt);
+            return sqlite3_exec(db, success ? "COMMIT;" : "ROLLBACK;", nullptr, nullptr, nullptr) == SQLITE_OK && success;
+        }
+
+    };
+
+    // Connections that aren't in use. They're shared by every thread, so they outlive the threads of a single batch or save
+    std::mutex connectionsMutex;
+    std::vector<std::unique_ptr<QueryConnection>> idleConnections;
+
+    // Takes an idle connection, or creates one if they're all in use
+    std::unique_ptr<QueryConnection> acquireConnection() {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        if (idleConnections.empty()) return std::make_unique<QueryConnection>();
+        std::unique_ptr<QueryConnection> connection = std::move(idleConnections.back());
+        idleConnections.pop_back();
+        return connection;
+    }
+
+    void releaseConnection(std::unique_ptr<QueryConnection> connection) {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        idleConnections.push_back(std::move(connection));
+    }
+
+    // Writes the database to dbFile, and returns whether it was successful
+    bool writeDBFile(std::string_view dbData, const std::filesystem::path &dbFile, std::vector<std::string> &errors) {
+        ProfileSpan span("database", "writeDBFile", dbFile);
+        std::ofstream fs(dbFile.string(), std::ios::out|std::ios::binary);
+        if (!fs.is_open()) {
+            errors.emplace_back("Legilimens was unable to write the database to a new file");
+            return false;
+        }
+        fs << dbData;
+        fs.close();
+        return true;
+    }
+
+    // Gets the URI that connections attach the database with, empty if it isn't available
+    // imageName is set to the image registered for ImageDB, which has to be unregistered once every connection is done with it
+    std::string getDBUri(std::string_view dbData, const AnalysisOptions &options, std::string &imageName, std::vector<std::string> &errors) {
+        if (options.dbMode == ImageDB) {
+            imageName = registerDBImage(dbData);
+            return getDBImageUri(imageName);
+        }
+        if (options.dbMode == MemoryDB) return ":memory:";
+        return writeDBFile(dbData, options.dbFile, errors) ? options.dbFile.string() : "";
+    }
+
+    // Runs a scan, adding each row to the results of the queries it matches
+    void runScan(QueryConnection &connection, const TableScan &scan, QueryResults &queryResults,
+                 std::unordered_set<TableEnum> &queryErrors) {
+        ProfileSpan span("sqlite", tables[scan.queries[0]].table);
+        sqlite3_stmt *stmt = connection.statement(connection.filterKeys() ? scan.keysSql : scan.sql);
+        bool classified = scan.queries.size() > 1;
+        std::vector<bool> failed(scan.queries.size(), false);
+        int status = SQLITE_ERROR;
+        bool readRows = false;
+        while (stmt != nullptr && (status = sqlite3_step(stmt)) == SQLITE_ROW) {
+            readRows = true;
+            for (int i = 0; i < scan.queries.size(); i++) {
+                if (failed[i] || (classified && sqlite3_column_int(stmt, 2*i + 1) == 0)) continue;
+                const auto *value = reinterpret_cast<const char *>(sqlite3_column_text(stmt, classified ? 2*i : 0));
+                if (value == nullptr) {
+                    failed[i] = true;
+                } else {
+                    addQueryResult(scan.queries[i], std::string_view(value, sqlite3_column_bytes(stmt, classified ? 2*i : 0)), queryResults);
+                }
+            }
+        }
+        if (stmt != nullptr) sqlite3_reset(stmt);
+        if (status != SQLITE_DONE && classified && !readRows) {
+            // One of the queries may use a column that doesn't exist in this save, so run them separately to only fail that one
+            for (int index : scan.queries) {
+                runScan(connection, {{index}, getScanSql({index}, false), getScanSql({index}, true)}, queryResults, queryErrors);
+            }
+            return;
+        }
+        if (status != SQLITE_DONE) failed.assign(failed.size(), true);
+        for (int i = 0; i < scan.queries.size(); i++) {
+            if (failed[i]) queryErrors.insert(TableEnum(scan.queries[i]));
+        }
+    }
+
+    // Runs scans with SQLite, and returns whether the database could be opened
+    // Each worker attaches the database to its own connection, then takes the next scan until they're all done
+    // Scans answer separate queries, so they write to separate sets of queryResults
+    bool runSqliteScans(std::string_view dbData, const AnalysisOptions &options, const std::vector<const TableScan *> &scans, Analysis &analysis) {
+        std::string imageName;
+        std::string uri = getDBUri(dbData, options, imageName, analysis.errors);
+        unsigned int workers = std::clamp<std::size_t>(options.queryWorkers, 1, scans.size());
+        std::atomic<std::size_t> nextScan = 0;
+        std::mutex errorsMutex;
+        bool opened = false;
+        runParallel(workers, workers, [&](std::size_t) {
+            std::unique_ptr<QueryConnection> connection = acquireConnection();
+            if (connection->attach(uri, dbData, options.dbMode)) {
+                std::unordered_set<TableEnum> queryErrors;
+                for (std::size_t i = nextScan++; i < scans.size(); i = nextScan++) {
+                    runScan(*connection, *scans[i], analysis.queryResults, queryErrors);
+                }
+                connection->detach();
+                std::lock_guard<std::mutex> lock(errorsMutex);
+                opened = true;
+                analysis.queryErrors.insert(queryErrors.begin(), queryErrors.end());
+            }
+            releaseConnection(std::move(connection));
+        });
+        if (!imageName.empty()) unregisterDBImage(imageName);
+        return opened;
+    }
+
+    // A "column=value" term of a condition, compiled for the native reader
+    struct NativeTerm {
+        int column;
+        bool numeric;        // Whether it's compared as a number rather than text, after applying the column's affinity
+        long long integer;
+        std::string text;
+    };
+
+    // A query compiled for the native reader
+    struct NativeQuery {
+        int column;
+        std::vector<NativeTerm> terms;
+    };
+
+    std::string_view trimSpaces(std::string_view text) {
+        while (!text.empty() && text.front() == ' ') text.remove_prefix(1);
+        while (!text.empty() && text.back() == ' ') text.remove_suffix(1);
+        return text;
+    }
+
+    bool parseInteger(std::string_view text, long long &result) {
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.length(), result);
+        return !text.empty() && ec == std::errc() && end == text.data() + text.length();
+    }
+
+    // Compiles a query for the native reader, and returns whether the native reader supports it
+    // Conditions can only be "column=value" terms joined by AND, where each value is a 'string' or an integer
+    bool compileNativeQuery(const QueryStruct &query, const DBTable &table, NativeQuery &result) {
+        result.column = table.columnIndex(query.column);
+        result.terms.clear();
+        if (result.column < 0) return false;
+        std::string_view condition = query.condition;
+        while (!condition.empty()) {
+            std::size_t nextAnd = condition.find(" AND ");
+            std::string_view term = condition.substr(0, nextAnd);
+            condition = (nextAnd == std::string_view::npos) ? std::string_view() : condition.substr(nextAnd + 5);
+            std::size_t equals = term.find('=');
+            if (equals == std::string_view::npos) return false;
+            NativeTerm nativeTerm = {table.columnIndex(trimSpaces(term.substr(0, equals))), false, 0, ""};
+            std::string_view literal = trimSpaces(term.substr(equals + 1));
+            if (nativeTerm.column < 0 || !table.columns[nativeTerm.column].binaryCollation) return false;
+            DBAffinity affinity = table.columns[nativeTerm.column].affinity;
+            if (literal.length() >= 2 && literal.front() == '\'' && literal.back() == '\'') {
+                nativeTerm.text = literal.substr(1, literal.length() - 2);
+                if (nativeTerm.text.find('\'') != std::string::npos) return false;
+                // Columns with numeric affinity compare text that looks like a number as a number
+                nativeTerm.numeric = affinity == NumericAffinity && parseInteger(nativeTerm.text, nativeTerm.integer);
+            } else if (parseInteger(literal, nativeTerm.integer)) {
+                // Columns with text affinity compare numbers as text
+                nativeTerm.numeric = affinity != TextAffinity;
+                nativeTerm.text = literal;
+            } else {
+                return false;
+            }
+            result.terms.push_back(nativeTerm);
+        }
+        return true;
+    }
+
+    bool matchesTerm(const DBValue &value, const NativeTerm &term) {
+        if (!term.numeric) return value.type == DBValue::Text && value.bytes == term.text;
+        if (value.type == DBValue::Integer) return value.integer == term.integer;
+        return value.type == DBValue::Real && value.real == static_cast<double>(term.integer);
+    }
+
+    // Adds the values of a row to the results of the queries it matches, and returns whether every value they needed could be read
+    // indexes are the queries' indexes in tables
+    bool addNativeRow(const DBRow &row, const std::vector<NativeQuery> &queries, const std::vector<int> &indexes,
+                      QueryResults &queryResults, std::string &number) {
+        DBValue value;
+        for (int i = 0; i < queries.size(); i++) {
+            bool matches = true;
+            for (auto term = queries[i].terms.begin(); matches && term != queries[i].terms.end(); term++) {
+                if (!row.column(term->column, value)) return false;
+                matches = matchesTerm(value, *term);
+            }
+            if (!matches) continue;
+            if (!row.column(queries[i].column, value)) return false;
+            int index = indexes[i];
+            // Like the catalog keys filter, only text can be the key of a collectible
+            if (tables[index].keysOnly) {
+                if (value.type == DBValue::Text) addQueryResult(index, value.bytes, queryResults);
+            } else if (value.type == DBValue::Text || value.type == DBValue::Blob) {
+                addQueryResult(index, value.bytes, queryResults);
+            } else if (value.type == DBValue::Integer) {
+                number = std::to_string(value.integer);
+                addQueryResult(index, number, queryResults);
+            } else {
+                // NULLs are errors like they are with SQLite, and reals would have to be formatted exactly like SQLite does
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Runs a scan with the native reader, and returns whether it could read every row it needed
+    // Otherwise the scan's results are left empty, for SQLite to fill in
+    bool runNativeScan(DBReader &reader, const TableScan &scan, QueryResults &queryResults) {
+        ProfileSpan span("native", tables[scan.queries[0]].table);
+        DBTable table;
+        if (!reader.findTable(tables[scan.queries[0]].table, table)) return false;
+        std::vector<NativeQuery> queries(scan.queries.size());
+        for (int i = 0; i < scan.queries.size(); i++) {
+            if (!compileNativeQuery(tables[scan.queries[i]], table, queries[i])) return false;
+        }
+        bool rowsValid = true;
+        std::string number;
+        bool complete = reader.scan(table, [&](const DBRow &row) {
+            rowsValid = rowsValid && addNativeRow(row, queries, scan.queries, queryResults, number);
+        });
+        if (complete && rowsValid) return true;
+        for (int index : scan.queries) queryResults.clear(index);
+        return false;
+    }
+
+    // Recovers whatever rows are still intact in the tables of failed queries, and reports how much of each table could be read
+    // Salvaged queries are no longer errors, but their results may be incomplete
+    void salvageQueries(std::string_view dbData, Analysis &analysis) {
+        ProfileSpan span("salvage", "salvageQueries");
+        DBReader reader(dbData);
+        std::vector<DBTable> dbTables;
+        std::vector<std::vector<int>> tableQueries;
+        std::vector<std::vector<NativeQuery>> nativeQueries;
+        for (int index = 0; reader.valid() && index < tables.size(); index++) {
+            if (!analysis.queryErrors.contains(TableEnum(index))) continue;
+            auto found = std::find_if(dbTables.begin(), dbTables.end(), [&](const DBTable &table) { return table.name == tables[index].table; });
+            DBTable table;
+            if (found == dbTables.end() && !reader.findTable(tables[index].table, table)) continue;
+            NativeQuery query;
+            if (!compileNativeQuery(tables[index], (found == dbTables.end()) ? table : *found, query)) continue;
+            if (found == dbTables.end()) {
+                // Keep the name the queries use, so later queries on the same table find it
+                table.name = tables[index].table;
+                dbTables.push_back(table);
+                tableQueries.emplace_back();
+                nativeQueries.emplace_back();
+                found = dbTables.end() - 1;
+            }
+            tableQueries[found - dbTables.begin()].push_back(index);
+            nativeQueries[found - dbTables.begin()].push_back(query);
+            analysis.queryResults.clear(index);
+        }
+        if (dbTables.empty()) {
+            analysis.errors.emplace_back("Nothing could be salvaged from the damaged parts of the database");
+            return;
+        }
+        std::vector<unsigned long long> unreadableRows(dbTables.size(), 0);
+        std::string number;
+        std::vector<DBCoverage> coverage = reader.salvage(dbTables, [&](int table, const DBRow &row) {
+            if (!addNativeRow(row, nativeQueries[table], tableQueries[table], analysis.queryResults, number)) unreadableRows[table]++;
+        });
+        for (int i = 0; i < dbTables.size(); i++) {
+            const DBCoverage &table = coverage[i];
+            // Without a single row, every collectible would look missing, so the table stays unreadable
+            if (table.pages == 0 || table.rows <= unreadableRows[i]) {
+                std::string message = "Nothing could be salvaged from " + dbTables[i].name;
+                if (table.damagedPages > 0) message += ", " + std::to_string(table.damagedPages) + " pages couldn't be read";
+                if (table.damagedCells + unreadableRows[i] > 0) message += ", " + std::to_string(table.damagedCells + unreadableRows[i]) + " rows couldn't be read";
+                analysis.errors.push_back(message);
+                continue;
+            }
+            for (int index : tableQueries[i]) {
+                analysis.queryErrors.erase(TableEnum(index));
+                analysis.salvagedQueries.insert(TableEnum(index));
+            }
+            std::string message = "Salvaged " + std::to_string(table.rows - unreadableRows[i]) + " rows of " + dbTables[i].name + " from " +
+                                  std::to_string(table.pages) + " pages";
+            if (table.orphanPages > 0) message += " (" + std::to_string(table.orphanPages) + " of them cut off from the table)";
+            if (table.damagedPages > 0) message += ", " + std::to_string(table.damagedPages) + " pages couldn't be read";
+            if (table.damagedCells + unreadableRows[i] > 0) message += ", " + std::to_string(table.damagedCells + unreadableRows[i]) + " rows couldn't be read";
+            if (!table.complete() || unreadableRows[i] > 0) message += ", so results from it may be incomplete";
+            analysis.errors.push_back(message);
+        }
+    }
+
+    // Adds an error for every query where the native reader and SQLite found different results
+    void compareReaders(const TableScan &scan, const QueryResults &nativeResults, Analysis &analysis) {
+        for (int index : scan.queries) {
+            const QueryStruct &query = tables[index];
+            std::string description = std::string(query.table) + "." + std::string(query.column) +
+                                      (query.condition.empty() ? "" : " where " + std::string(query.condition));
+            if (analysis.queryErrors.contains(TableEnum(index))) {
+                analysis.errors.push_back("Only the native reader was able to read " + description);
+                continue;
+            }
+            const KeySet &sqliteValues = analysis.queryResults.values[index];
+            const CollectibleSet &sqliteCollectibles = analysis.queryResults.collectibles[index];
+            // keysOnly queries only keep collectibles, and the rest only find collectibles through their values
+            unsigned long onlySqlite = (sqliteCollectibles & ~nativeResults.collectibles[index]).count();
+            unsigned long onlyNative = (nativeResults.collectibles[index] & ~sqliteCollectibles).count();
+            if (!query.keysOnly) {
+                onlySqlite = onlyNative = 0;
+                for ( const auto &value : sqliteValues ) {
+                    if (!nativeResults.values[index].contains(value)) onlySqlite++;
+                }
+                for ( const auto &value : nativeResults.values[index] ) {
+                    if (!sqliteValues.contains(value)) onlyNative++;
+                }
+            }
+            if (onlySqlite > 0 || onlyNative > 0) {
+                analysis.errors.push_back("The native reader and SQLite disagree on " + description + ": " + std::to_string(onlySqlite) +
+                                          " results only found by SQLite, " + std::to_string(onlyNative) + " only by the native reader");
+            }
+        }
+    }
+}
+
+bool queryDB(std::string_view dbData, const AnalysisOptions &options, Analysis &analysis) {
+    ProfileSpan span("analysis", "queryDB");
+    analysis.queryResults.reset();
+    const std::vector<TableScan> &plan = getQueryPlan();
+    // The native reader goes first, then SQLite runs whatever it couldn't read, or everything to cross-check it
+    QueryResults nativeResults;
+    nativeResults.reset();
+    std::vector<bool> readNatively(plan.size(), false);
+    if (options.reader != SqliteReader) {
+        DBReader reader(dbData);
+        for (int i = 0; reader.valid() && i < plan.size(); i++) readNatively[i] = runNativeScan(reader, plan[i], nativeResults);
+    }
+    std::vector<const TableScan *> sqliteScans;
+    for (int i = 0; i < plan.size(); i++) {
+        if (options.reader == VerifyReader || !readNatively[i]) sqliteScans.push_back(&plan[i]);
+    }
+    bool opened = sqliteScans.empty() || runSqliteScans(dbData, options, sqliteScans, analysis);
+    if (options.salvage && !opened) {
+        for (const TableScan *scan : sqliteScans) {
+            for (int index : scan->queries) analysis.queryErrors.insert(TableEnum(index));
+        }
+    }
+    for (int i = 0; i < plan.size(); i++) {
+        if (!readNatively[i]) continue;
+        if (options.reader == VerifyReader) {
+            compareReaders(plan[i], nativeResults, analysis);
+        } else {
+            for (int index : plan[i].queries) {
+                analysis.queryResults.values[index] = std::move(nativeResults.values[index]);
+                analysis.queryResults.collectibles[index] = nativeResults.collectibles[index];
+            }
+        }
+    }
+    if (options.salvage && !analysis.queryErrors.empty()) {
+        salvageQueries(dbData, analysis);
+        opened = opened || !analysis.salvagedQueries.empty();
+    }
+    int err = SQLITE_ERROR;
+    if (opened && analysis.queryErrors.size() < tables.size()) {
+        err = SQLITE_OK;
+    } else {
+        analysis.errors.emplace_back("SQLite was unable to read the database");
+    }
+    // Remove database file
+    std::error_code ec;
+    if (options.dbMode == FileDB && std::filesystem::exists(options.dbFile) && !std::filesystem::remove(options.dbFile, ec)) {
+        analysis.errors.push_back("Error removing database file \"" + options.dbFile.string() + "\"");
+        analysis.errors.push_back(ec.message());
+    }
+    return (err == SQLITE_OK);
+}
+
+bool readDB(const std::filesystem::path &saveFile, SaveCache &cache, const AnalysisOptions &options, Analysis &analysis) {
+    SaveFile save;
+    std::string_view dbData;
+    if (!extractDB(saveFile, cache, save, dbData, analysis.errors)) return false;
+    return queryDB(dbData, options, analysis);
+}
+
+// Returns whether the save is affected by the butterfly quest bug
+// i.e. "Follow the Butterflies" is complete, but Butterfly Chest #1 is not collected
+bool hasButterlyBug(const Analysis &analysis) {
+    if (analysis.queryErrors.contains(EconomicExpiryDynamic) || analysis.queryErrors.contains(PlayerStatsDynamic)) return false;
+    // Check if the butterfly mission is completed
+    if (!analysis.queryResults.values[PlayerStatsDynamic].contains(CollectibleKeyView("COM_11"))) return false;
+    // Get the quest's butterfly chest
+    for (int i = 0; i < collectibles.size(); i++) {
+        if (collectibles[i].type == ButterflyChest && collectibles[i].index == "1") {
+            // If it hasn't been collected, then the bug happened
+            return !analysis.collected.test(i);
+        }
+    }
+    return false; // Should never reach here
+}
+
+// Returns whether the save is affected by the missing conjuration bug
+// i.e. the save has one less conjuration than conjuration chests collected
+bool hasConjurationBug(const Analysis &analysis) {
+    const std::unordered_set<TableEnum> &queryErrors = analysis.queryErrors;
+    if (queryErrors.contains(CollectionDynamic2) || queryErrors.contains(LootDropComponentDynamic) || queryErrors.contains(EconomicExpiryDynamic) || queryErrors.contains(MapLocationDataDynamic)) return false;
+    // Check if more chests than conjurations
+    return (analysis.conjurationChestsOpened > analysis.queryResults.values[CollectionDynamic2].size());
+}
+
+// Finds the missing collectibles and known bugs from the query results
+// Each table's query found the collectibles whose keys it returned, so this only has to combine them with the catalog's masks
+void findMissing(Analysis &analysis) {
+    ProfileSpan span("analysis", "findMissing");
+    CollectibleSet readable;
+    for (int table = 0; table < tables.size(); table++) {
+        if (analysis.queryErrors.contains(TableEnum(table))) continue;
+        const CollectibleSet &tableMask = getTableMask(TableEnum(table));
+        readable |= tableMask;
+        analysis.collected |= analysis.queryResults.collectibles[table] & tableMask;
+    }
+    analysis.missing = readable & ~analysis.collected;
+    static const CollectibleSet conjurationChests = getTypeMask(MiscConjChest) | getTypeMask(ArithmancyChest) | getTypeMask(DungeonChest) |
+                                                    getTypeMask(ButterflyChest) | getTypeMask(VivariumChest);
+    analysis.conjurationChestsOpened = (analysis.collected & conjurationChests).count();
+    // Check for bugs
+    analysis.butterflyBug = hasButterlyBug(analysis);
+    analysis.conjurationBug = hasConjurationBug(analysis);
+}
+
+bool analyzeSave(const std::filesystem::path &saveFile, SaveCache &cache, const AnalysisOptions &options, Analysis &analysis) {
+    ProfileSpan span("analysis", "analyzeSave", saveFile);
+    // Query all the necessary tables
+    if (!readDB(saveFile, cache, options, analysis)) return false;
+    findMissing(analysis);
+    return true;
+}
+
+bool analyzeSaveData(std::string_view saveData, const AnalysisOptions &options, Analysis &analysis) {
+    ProfileSpan span("analysis", "analyzeSaveData");
+    if (!saveData.starts_with(MAGIC_HEADER)) {
+        analysis.errors.emplace_back("The data doesn't seem to be a Hogwarts Legacy save file");
+        return false;
+    }
+    std::string_view dbData;
+    if (!findDB(saveData, dbData, analysis.errors) || !queryDB(dbData, options, analysis)) return false;
+    findMissing(analysis);
+    return true;
+}
+
+SaveDiff diffSaves(const Analysis &previous, const Analysis &latest) {
+    // Collectibles whose tables couldn't be read are neither collected nor missing, so they never show up as changed
+    return {previous.missing & latest.collected, previous.collected & latest.missing};
+}
+
+struct TableScanner::State {
+    std::string_view dbData;
+    AnalysisOptions options;
+    std::string imageName;
+    std::unique_ptr<QueryConnection> connection;
+    bool attached = false;
+    DBReader reader;
+
+    State(std::string_view data, const AnalysisOptions &scanOptions) : dbData(data), options(scanOptions), reader(data) {}
+};
+
+TableScanner::TableScanner(std::string_view dbData, const AnalysisOptions &options) : state(std::make_unique<State>(dbData, options)) {
+    std::vector<std::string> errors;
+    std::string uri = getDBUri(dbData, options, state->imageName, errors);
+    state->connection = acquireConnection();
+    state->attached = state->connection->attach(uri, dbData, options.dbMode);
+}
+
+TableScanner::~TableScanner() {
+    if (state->attached) state->connection->detach();
+    releaseConnection(std::move(state->connection));
+    if (!state->imageName.empty()) unregisterDBImage(state->imageName);
+    std::error_code ec;
+    if (state->options.dbMode == FileDB) std::filesystem::remove(state->options.dbFile, ec);
+}
+
+bool TableScanner::valid() const {
+    return state->attached;
+}
+
+std::size_t TableScanner::size() const {
+    return getQueryPlan().size();
+}
+
+std::string_view TableScanner::table(std::size_t scan) const {
+    return tables[getQueryPlan()[scan].queries[0]].table;
+}
+
+bool TableScanner::scanSqlite(std::size_t scan, QueryResults &results) {
+    const TableScan &tableScan = getQueryPlan()[scan];
+    for (int index : tableScan.queries) results.clear(index);
+    std::unordered_set<TableEnum> queryErrors;
+    runScan(*state->connection, tableScan, results, queryErrors);
+    return queryErrors.empty();
+}
+
+bool TableScanner::scanNative(std::size_t scan, QueryResults &results) {
+    const TableScan &tableScan = getQueryPlan()[scan];
+    for (int index : tableScan.queries) results.clear(index);
+    return state->reader.valid() && runNativeScan(state->reader, tableScan, results);
+}
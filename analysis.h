@@ -0,0 +1,113 @@
+#ifndef LEGILIMENS_HOGWARTS_LEGACY_CPP_ANALYSIS_H
+#define LEGILIMENS_HOGWARTS_LEGACY_CPP_ANALYSIS_H
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "collectibles.h"
+#include "savecache.h"
+#include "savefile.h"
+#include "sqlite3.h"
+
+// How the database contained in the save is handed to SQLite
+enum DBMode {
+    ImageDB = 0,  // Read in place through the image VFS, without copying it out of the save
+    MemoryDB = 1, // Copied into SQLite's memory with sqlite3_deserialize
+    FileDB = 2    // Written to a temporary file next to the executable
+};
+
+// What reads the tables of the save's database
+enum DBReaderMode {
+    SqliteReader = 0, // SQLite runs every query
+    NativeReader = 1, // Tables are read straight from the database's pages (see dbreader.h), and SQLite only runs what that couldn't read
+    VerifyReader = 2  // Both run every query, and any difference between them is reported as an error
+};
+
+// How saves are loaded and queried
+struct AnalysisOptions {
+    DBMode dbMode = ImageDB;
+    std::filesystem::path dbFile; // Only used with FileDB
+    unsigned int queryWorkers = 1; // Number of connections reading the save's tables at once
+    DBReaderMode reader = SqliteReader;
+    bool salvage = false; // Whether to recover what it can of tables that can't be read, instead of giving up on them
+};
+
+// What the queries found in a save, by index in tables
+struct QueryResults {
+    std::vector<KeySet> values;               // Values returned by each query, except keysOnly queries which only need collectibles
+    std::vector<CollectibleSet> collectibles; // Collectibles whose keys each query returned
+
+    void reset() {
+        values.assign(tables.size(), {});
+        collectibles.assign(tables.size(), {});
+    }
+    void clear(int index) {
+        values[index].clear();
+        collectibles[index].reset();
+    }
+};
+
+// Everything Legilimens found out about a save
+struct Analysis {
+    QueryResults queryResults;
+    std::unordered_set<TableEnum> queryErrors;
+    std::unordered_set<TableEnum> salvagedQueries; // Queries salvaged from a damaged database, whose results may be incomplete
+    CollectibleSet collected; // Collectibles found in the save
+    CollectibleSet missing;   // Collectibles that weren't found, out of those whose tables could be read
+    unsigned long conjurationChestsOpened = 0;
+    bool butterflyBug = false;
+    bool conjurationBug = false;
+    std::vector<std::string> errors; // Messages for the user about anything that went wrong
+};
+
+// What changed between two saves of the same character, out of the collectibles that could be read in both
+struct SaveDiff {
+    CollectibleSet collected; // Missing in the previous save, collected in the latest
+    CollectibleSet lost;      // Collected in the previous save, missing in the latest, e.g. if the saves are given the wrong way around
+};
+
+// Points dbData at the database contained in the bytes of a save, and returns whether it was successful
+bool findDB(std::string_view saveData, std::string_view &dbData, std::vector<std::string> &errors);
+// Opens saveFile and points dbData at the database contained in it, and returns whether it was successful
+bool extractDB(const std::filesystem::path &saveFile, SaveCache &cache, SaveFile &save, std::string_view &dbData, std::vector<std::string> &errors);
+// Reads the tables in a database image, and returns whether it was successful
+// dbData must stay valid until this returns
+bool queryDB(std::string_view dbData, const AnalysisOptions &options, Analysis &analysis);
+// Reads the tables in the save's database, and returns whether it was successful
+bool readDB(const std::filesystem::path &saveFile, SaveCache &cache, const AnalysisOptions &options, Analysis &analysis);
+// Finds the missing collectibles and known bugs from the results of queryDB
+void findMissing(Analysis &analysis);
+// Reads the save and finds every missing collectible and known bug, and returns whether it was successful
+bool analyzeSave(const std::filesystem::path &saveFile, SaveCache &cache, const AnalysisOptions &options, Analysis &analysis);
+// Same as analyzeSave, for a save that's already in memory (e.g. uploaded rather than on disk)
+bool analyzeSaveData(std::string_view saveData, const AnalysisOptions &options, Analysis &analysis);
+// Compares the analyses of two saves
+SaveDiff diffSaves(const Analysis &previous, const Analysis &latest);
+
+// Runs the scans of queryDB one table at a time, so each can be timed on its own (see benchmarks/stage_benchmark.cpp)
+// The database is attached like queryDB does for as long as the scanner exists, so dbData must stay valid until then
+class TableScanner {
+public:
+    TableScanner(std::string_view dbData, const AnalysisOptions &options);
+    TableScanner(const TableScanner &) = delete;
+    TableScanner &operator=(const TableScanner &) = delete;
+    ~TableScanner();
+
+    // Whether SQLite was able to attach the database
+    bool valid() const;
+    // Number of scans, each reading one table
+    std::size_t size() const;
+    std::string_view table(std::size_t scan) const;
+    // Runs a scan with SQLite or the native reader, replacing the results of its queries, and returns whether it read every row
+    bool scanSqlite(std::size_t scan, QueryResults &results);
+    bool scanNative(std::size_t scan, QueryResults &results);
+
+private:
+    struct State;
+    std::unique_ptr<State> state;
+};
+
+#endif //LEGILIMENS_HOGWARTS_LEGACY_CPP_ANALYSIS_H
@@ -0,0 +1,75 @@
+// Writes a synthetic save, see syntheticsave.h
+// Usage: SaveGenerator out.sav [--collected 0.5] [--type Merlin=0.2 ...] [--noise 20000] [--seed 1]
+//                             [--corrupt-root TABLE ...] [--corrupt-leaf TABLE ...] [--corrupt-header]
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include "../argparse.hpp"
+#include "syntheticsave.h"
+
+namespace {
+    // Parses a list of TYPE=FRACTION, where TYPE is a collectible type's name like in collectibles.cpp
+    bool parseTypeFractions(const std::vector<std::string> &args, std::unordered_map<CollectibleEnum, double> &result) {
+        for ( const auto &arg : args ) {
+            std::size_t equals = arg.find('=');
+            int type = 0;
+            while (type < collectibleTypes.size() && (equals == std::string::npos || collectibleTypes[type].name != std::string_view(arg).substr(0, equals))) type++;
+            if (type == collectibleTypes.size()) {
+                std::cerr << "Unknown collectible type in \"" << arg << "\"" << std::endl;
+                return false;
+            }
+            double fraction = 0;
+            auto [end, ec] = std::from_chars(arg.data() + equals + 1, arg.data() + arg.length(), fraction);
+            if (ec != std::errc() || end != arg.data() + arg.length() || fraction < 0 || fraction > 1) {
+                std::cerr << "Fractions must be between 0 and 1, in \"" << arg << "\"" << std::endl;
+                return false;
+            }
+            result[CollectibleEnum(type)] = fraction;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    argparse::ArgumentParser program("SaveGenerator");
+    program.add_argument("file").help("Path of the .sav file to write");
+    program.add_argument("--collected").scan<'g', double>().default_value(0.5).help("Fraction of each type's collectibles that are collected");
+    program.add_argument("--type").nargs(argparse::nargs_pattern::at_least_one).help("Fraction collected of specific types, e.g. Merlin=0.2 FinishingTouches=1");
+    program.add_argument("--noise").scan<'u', unsigned long>().default_value(20000ul).help("Number of rows that aren't collected collectibles");
+    program.add_argument("--seed").scan<'u', unsigned int>().default_value(1u).help("Seed of the random rows. The same seed and options give the same save");
+    program.add_argument("--corrupt-root").nargs(argparse::nargs_pattern::at_least_one).help("Tables to damage the root page of, so they can't be read at all");
+    program.add_argument("--corrupt-leaf").nargs(argparse::nargs_pattern::at_least_one).help("Tables to damage the first leaf page of, so only part of them can be read");
+    program.add_argument("--corrupt-header").default_value(false).implicit_value(true).help("Damages the database header, so it can't be opened");
+    try {
+        program.parse_args(argc, argv);
+    } catch (const std::runtime_error &err) {
+        std::cerr << err.what() << std::endl << program;
+        return 1;
+    }
+    SyntheticSaveOptions options;
+    options.collected = program.get<double>("--collected");
+    options.noiseRows = program.get<unsigned long>("--noise");
+    options.seed = program.get<unsigned int>("--seed");
+    if (program.is_used("--type") && !parseTypeFractions(program.get<std::vector<std::string>>("--type"), options.collectedByType)) return 1;
+    if (program.is_used("--corrupt-root")) {
+        for ( const auto &table : program.get<std::vector<std::string>>("--corrupt-root") ) options.damage.push_back({CorruptRootPage, table});
+    }
+    if (program.is_used("--corrupt-leaf")) {
+        for ( const auto &table : program.get<std::vector<std::string>>("--corrupt-leaf") ) options.damage.push_back({CorruptLeafPage, table});
+    }
+    if (program.get<bool>("--corrupt-header")) options.damage.push_back({CorruptHeader, ""});
+    std::string save, error;
+    CollectibleSet collected;
+    if (!makeSyntheticSave(options, save, collected, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    std::string file = program.get<std::string>("file");
+    std::ofstream fs(file, std::ios::out | std::ios::binary);
+    if (!fs.is_open() || !fs.write(save.data(), static_cast<std::streamsize>(save.length()))) {
+        std::cerr << "Unable to write to \"" << file << "\"" << std::endl;
+        return 1;
+    }
+    std::cout << file << ": " << save.length() << " bytes, " << collected.count() << " of " << collectibles.size() << " collectibles collected" << std::endl;
+    return 0;
+}
@@ -0,0 +1,154 @@
+// Times each stage of analyzing a save on synthetic saves of several sizes, so a regression in any of them shows up:
+// finding the database in the save, attaching it to SQLite, each table's scan with each reader, the whole of queryDB
+// with each reader, matching results against the catalog, and rendering the tables
+// Usage: StageBenchmark [iterations] [noise rows...]
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include "../analysis.h"
+#include "../output.h"
+#include "../report.h"
+#include "../tabulate.hpp"
+#include "syntheticsave.h"
+
+namespace {
+    // Runs stage iterations times, and prints how long it took on average
+    template <typename Stage>
+    void timeStage(const std::string &name, unsigned long iterations, Stage stage) {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned long i = 0; i < iterations; i++) stage();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "  " << std::left << std::setw(48) << name << std::right << std::setw(10) << std::fixed << std::setprecision(3)
+                  << elapsed.count() / static_cast<double>(iterations) << " ms" << std::endl;
+    }
+
+    // A file that's removed when it goes out of scope, however the function that made it returns
+    struct TempFile {
+        std::filesystem::path path;
+
+        ~TempFile() {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+    };
+
+    // Parses a whole argument as a number, and returns whether it was one
+    bool parseNumber(std::string_view arg, unsigned long &result) {
+        auto [end, ec] = std::from_chars(arg.data(), arg.data() + arg.length(), result);
+        return !arg.empty() && ec == std::errc() && end == arg.data() + arg.length();
+    }
+
+    bool benchmarkSave(unsigned long noiseRows, unsigned long iterations) {
+        SyntheticSaveOptions saveOptions;
+        saveOptions.noiseRows = noiseRows;
+        std::string saveData, error;
+        CollectibleSet collected;
+        if (!makeSyntheticSave(saveOptions, saveData, collected, error)) {
+            std::cerr << error << std::endl;
+            return false;
+        }
+        std::error_code ec;
+        std::filesystem::path tempDirectory = std::filesystem::temp_directory_path(ec);
+        if (ec) {
+            std::cerr << "Unable to find the temp directory: " << ec.message() << std::endl;
+            return false;
+        }
+        // Declared before save, so the file is closed before it's removed
+        TempFile tempSave{tempDirectory / ("legilimens-benchmark-" + std::to_string(noiseRows) + ".sav")};
+        const std::filesystem::path &saveFile = tempSave.path;
+        std::ofstream fs(saveFile, std::ios::out | std::ios::binary);
+        fs.write(saveData.data(), static_cast<std::streamsize>(saveData.length()));
+        fs.close();
+        if (!fs) {
+            std::cerr << "Unable to write \"" << saveFile.string() << "\"" << std::endl;
+            return false;
+        }
+        SaveCache cache;
+        SaveFile save;
+        std::string_view dbData;
+        std::vector<std::string> errors;
+        if (!extractDB(saveFile, cache, save, dbData, errors)) {
+            for ( const auto &message : errors ) std::cerr << message << std::endl;
+            return false;
+        }
+        std::cout << noiseRows << " noise rows: " << saveData.length() << " byte save, " << dbData.length() << " byte database" << std::endl;
+
+        timeStage("extractDB", iterations, [&] {
+            SaveFile stageSave;
+            std::string_view stageDB;
+            extractDB(saveFile, cache, stageSave, stageDB, errors);
+        });
+        // What queryDB does for each save before its scans: registering the image, and attaching it to a pooled connection
+        AnalysisOptions options;
+        timeStage("attach", iterations, [&] {
+            TableScanner scanner(dbData, options);
+        });
+        // The same scans as queryDB, one table at a time
+        {
+            TableScanner scanner(dbData, options);
+            QueryResults results;
+            results.reset();
+            for (std::size_t i = 0; i < scanner.size(); i++) {
+                bool read = true;
+                timeStage("sqlite scan " + std::string(scanner.table(i)), iterations, [&] {
+                    read = scanner.scanSqlite(i, results) && read;
+                });
+                timeStage("native scan " + std::string(scanner.table(i)), iterations, [&] {
+                    read = scanner.scanNative(i, results) && read;
+                });
+                if (!scanner.valid() || !read) {
+                    std::cerr << "Unable to read " << scanner.table(i) << std::endl;
+                    return false;
+                }
+            }
+        }
+
+        Analysis analysis;
+        for (DBReaderMode reader : {SqliteReader, NativeReader}) {
+            options.reader = reader;
+            timeStage(reader == SqliteReader ? "queryDB, sqlite reader" : "queryDB, native reader", iterations, [&] {
+                analysis = Analysis();
+                queryDB(dbData, options, analysis);
+            });
+        }
+        timeStage("findMissing", iterations, [&] {
+            analysis.collected.reset();
+            findMissing(analysis);
+        });
+        std::size_t rendered = 0;
+        timeStage("render (" + std::to_string(analysis.missing.count()) + " missing)", iterations, [&] {
+            std::ostringstream buffer;
+            buffer << termcolor::colorize;
+            writeMissingTables(buffer, analysis.missing, false);
+            rendered = buffer.str().length();
+        });
+        // Timings are only worth anything if the save was analyzed correctly
+        if (!analysis.errors.empty() || analysis.missing != ~collected || rendered == 0) {
+            for ( const auto &message : analysis.errors ) std::cerr << message << std::endl;
+            std::cerr << "Legilimens didn't find the collectibles the synthetic save has" << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long iterations = 20;
+    std::vector<unsigned long> sizes(std::max(argc - 2, 0));
+    bool valid = argc < 2 || (parseNumber(argv[1], iterations) && iterations > 0);
+    for (int i = 2; valid && i < argc; i++) valid = parseNumber(argv[i], sizes[i - 2]);
+    if (!valid) {
+        std::cerr << "Usage: StageBenchmark [iterations] [noise rows...]" << std::endl;
+        return 1;
+    }
+    if (sizes.empty()) sizes = {2000, 20000, 200000};
+    for (unsigned long noiseRows : sizes) {
+        if (!benchmarkSave(noiseRows, iterations)) return 1;
+    }
+    return 0;
+}
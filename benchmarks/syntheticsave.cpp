@@ -0,0 +1,361 @@
+#include "syntheticsave.h"
+#include <cstdint>
+#include <random>
+#include "../dbreader.h"
+#include "../getsave.h"
+#include "../sqlite3.h"
+
+namespace {
+    // The tables Legilimens reads, with the columns its queries use
+    const char *const schemaSql =
+        "CREATE TABLE CollectionDynamic(ItemID TEXT, CategoryID TEXT, SubcategoryID TEXT, ItemState TEXT, UpdateTime INTEGER);"
+        "CREATE TABLE SphinxPuzzleDynamic(SphinxPuzzleGUID TEXT, EInteractiveState INTEGER);"
+        "CREATE TABLE LootDropComponentDynamic(ActorID TEXT, LootGroup TEXT);"
+        "CREATE TABLE EconomicExpiryDynamic(UniqueID TEXT, ExpiryTime INTEGER);"
+        "CREATE TABLE MiscDataDynamic(DataName TEXT, DataOwner TEXT, DataValue TEXT);"
+        "CREATE TABLE MapLocationDataDynamic(MapLocationID TEXT, State INTEGER, Payload TEXT);"
+        "CREATE TABLE AchievementDynamic(AchievementID TEXT, Progress INTEGER, OneOfEach TEXT);"
+        "CREATE TABLE PlayerStatsDynamic(ActivityName TEXT, ActivityValue TEXT);";
+
+    // Where noise rows go, roughly in proportion to how big each table is in a real save
+    const TableEnum noiseTables[] = {
+        MapLocationDataDynamic, MapLocationDataDynamic, MapLocationDataDynamic, MapLocationDataDynamic, MapLocationDataDynamic,
+        MapLocationDataDynamic, MapLocationDataDynamic, MapLocationDataDynamic, MapLocationDataDynamic, MapLocationDataDynamic,
+        CollectionDynamic, CollectionDynamic, MiscDataDynamic, MiscDataDynamic, LootDropComponentDynamic, EconomicExpiryDynamic,
+        PlayerStatsDynamic, AchievementDynamic
+    };
+
+    // Types whose chests each give a conjuration, see hasConjurationBug
+    const CollectibleEnum conjurationChestTypes[] = {MiscConjChest, ArithmancyChest, DungeonChest, ButterflyChest, VivariumChest};
+
+    // Prepared inserts into every table, in one transaction
+    class DBWriter {
+    public:
+        ~DBWriter() {
+            for (sqlite3_stmt *stmt : inserts) sqlite3_finalize(stmt);
+            if (db) sqlite3_close(db);
+        }
+
+        bool open(std::string &error) {
+            if (sqlite3_open(":memory:", &db) != SQLITE_OK || sqlite3_exec(db, schemaSql, nullptr, nullptr, nullptr) != SQLITE_OK ||
+                sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+                error = db ? sqlite3_errmsg(db) : "SQLite couldn't open a database in memory";
+                return false;
+            }
+            const char *const sql[] = {
+                "INSERT INTO CollectionDynamic VALUES(?1, ?2, ?3, ?4, ?5);",
+                "INSERT INTO SphinxPuzzleDynamic VALUES(?1, ?2);",
+                "INSERT INTO LootDropComponentDynamic VALUES(?1, ?2);",
+                "INSERT INTO EconomicExpiryDynamic VALUES(?1, ?2);",
+                "INSERT INTO MiscDataDynamic VALUES(?1, ?2, ?3);",
+                "INSERT INTO MapLocationDataDynamic VALUES(?1, ?2, ?3);",
+                "INSERT INTO AchievementDynamic VALUES(?1, ?2, ?3);",
+                "INSERT INTO PlayerStatsDynamic VALUES(?1, ?2);"
+            };
+            for (const char *statement : sql) {
+                sqlite3_stmt *stmt = nullptr;
+                if (sqlite3_prepare_v2(db, statement, -1, &stmt, nullptr) != SQLITE_OK) {
+                    error = sqlite3_errmsg(db);
+                    return false;
+                }
+                inserts.push_back(stmt);
+            }
+            return true;
+        }
+
+        // Inserts a row, where each value is text or, if it's an integer, a long long
+        template <typename... Values>
+        void insert(TableEnum table, const Values &...values) {
+            sqlite3_stmt *stmt = inserts[table];
+            int column = 1;
+            (bind(stmt, column++, values), ...);
+            if (sqlite3_step(stmt) != SQLITE_DONE) failed = true;
+            sqlite3_reset(stmt);
+        }
+
+        // Commits the rows, and copies the database's file image into image
+        bool serialize(std::string &image, std::string &error) {
+            if (failed || sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+                error = sqlite3_errmsg(db);
+                return false;
+            }
+            sqlite3_int64 size = 0;
+            unsigned char *bytes = sqlite3_serialize(db, "main", &size, 0);
+            if (!bytes) {
+                error = "SQLite couldn't serialize the database";
+                return false;
+            }
+            image.assign(reinterpret_cast<const char *>(bytes), static_cast<std::size_t>(size));
+            sqlite3_free(bytes);
+            return true;
+        }
+
+    private:
+        sqlite3 *db = nullptr;
+        std::vector<sqlite3_stmt *> inserts;
+        bool failed = false;
+
+        static void bind(sqlite3_stmt *stmt, int column, const std::string &value) {
+            sqlite3_bind_text(stmt, column, value.data(), static_cast<int>(value.length()), SQLITE_TRANSIENT);
+        }
+        static void bind(sqlite3_stmt *stmt, int column, std::string_view value) {
+            sqlite3_bind_text(stmt, column, value.data(), static_cast<int>(value.length()), SQLITE_TRANSIENT);
+        }
+        static void bind(sqlite3_stmt *stmt, int column, const char *value) {
+            sqlite3_bind_text(stmt, column, value, -1, SQLITE_STATIC);
+        }
+        static void bind(sqlite3_stmt *stmt, int column, long long value) {
+            sqlite3_bind_int64(stmt, column, value);
+        }
+    };
+
+    // Random keys and text, shaped like the game's
+    class NoiseSource {
+    public:
+        explicit NoiseSource(unsigned int seed) : rng(seed) {}
+
+        unsigned long below(unsigned long limit) { return std::uniform_int_distribution<unsigned long>(0, limit - 1)(rng); }
+        bool chance(double probability) { return std::uniform_real_distribution<double>(0, 1)(rng) < probability; }
+
+        // A GUID written as 32 uppercase hex digits, like butterfly chests' and Merlin trials' keys
+        std::string guid() {
+            static const char hexDigits[] = "0123456789ABCDEF";
+            std::string result(32, '0');
+            for (char &c : result) c = hexDigits[below(16)];
+            return result;
+        }
+
+        // A name like the game's other keys, e.g. "Hogsmeade_Loc_1234"
+        std::string name(const char *prefix) {
+            static const char *const places[] = {"Hogsmeade", "Hogwarts", "Feldcroft", "Irondale", "Keenbridge", "Lower_Hogsfield", "Marunweem", "Poidsear"};
+            return std::string(places[below(8)]) + "_" + prefix + "_" + std::to_string(below(100000));
+        }
+
+        std::string text(unsigned long maxLength) {
+            std::string result(below(maxLength + 1), 'x');
+            for (char &c : result) c = static_cast<char>('a' + below(26));
+            return result;
+        }
+
+        std::mt19937 rng;
+    };
+
+    void addNoiseRow(DBWriter &db, NoiseSource &noise) {
+        static const long long mapStates[] = {0, 3, 11};
+        TableEnum table = noiseTables[noise.below(std::size(noiseTables))];
+        switch (table) {
+            case CollectionDynamic:
+                db.insert(table, noise.name("Gear"), "Gear", noise.chance(0.5) ? "Hats" : "Robes", noise.chance(0.7) ? "Obtained" : "Seen", (long long) noise.below(1000000));
+                break;
+            case MiscDataDynamic:
+                db.insert(table, noise.name("Data"), "Player", std::to_string(noise.below(3)));
+                break;
+            case LootDropComponentDynamic:
+                db.insert(table, noise.guid(), noise.guid());
+                break;
+            case EconomicExpiryDynamic:
+                db.insert(table, noise.guid(), (long long) noise.below(1000000));
+                break;
+            case PlayerStatsDynamic:
+                db.insert(table, noise.name("Stat"), noise.chance(0.5) ? "Complete" : std::to_string(noise.below(100)));
+                break;
+            case AchievementDynamic:
+                db.insert(table, "ACH_" + std::to_string(noise.below(1000)), (long long) noise.below(100), noise.text(40));
+                break;
+            default:
+                db.insert(MapLocationDataDynamic, noise.chance(0.3) ? noise.guid() : noise.name("Loc"), mapStates[noise.below(3)], noise.text(200));
+                break;
+        }
+    }
+
+    // Inserts the row that marks a collectible collected, or for some missing ones, the row the game keeps before it's collected
+    void addCollectibleRow(DBWriter &db, NoiseSource &noise, const CollectibleStruct &collectible, bool collected, std::string &finishingTouches) {
+        std::string_view key = collectible.key.text;
+        switch (collectibleTypes[collectible.type].table) {
+            case CollectionDynamic:
+                if (collected || noise.chance(0.3)) db.insert(CollectionDynamic, key, "FieldGuide", "Revelio", collected ? "Obtained" : "Seen", (long long) noise.below(1000000));
+                break;
+            case SphinxPuzzleDynamic:
+                if (collected || noise.chance(0.5)) db.insert(SphinxPuzzleDynamic, key, collected ? 34LL : 0LL);
+                break;
+            case LootDropComponentDynamic:
+                if (collected) db.insert(LootDropComponentDynamic, noise.guid(), key);
+                break;
+            case EconomicExpiryDynamic:
+                if (collected) db.insert(EconomicExpiryDynamic, key, (long long) noise.below(1000000));
+                break;
+            case MiscDataDynamic:
+                if (collected || noise.chance(0.3)) db.insert(MiscDataDynamic, key, "Player", collected ? "1" : "0");
+                break;
+            case MapLocationDataDynamic:
+                if (collected || noise.chance(0.5)) db.insert(MapLocationDataDynamic, key, collected ? 11LL : 3LL, noise.text(200));
+                break;
+            case AchievementDynamic:
+                if (collected) {
+                    if (!finishingTouches.empty()) finishingTouches += ",";
+                    finishingTouches += key;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    void appendInt32(std::string &out, std::int32_t value) {
+        for (int i = 0; i < 4; i++) out += static_cast<char>((static_cast<std::uint32_t>(value) >> (8 * i)) & 0xFF);
+    }
+
+    void appendInt64(std::string &out, std::int64_t value) {
+        for (int i = 0; i < 8; i++) out += static_cast<char>((static_cast<std::uint64_t>(value) >> (8 * i)) & 0xFF);
+    }
+
+    void appendFString(std::string &out, std::string_view value) {
+        appendInt32(out, static_cast<std::int32_t>(value.length() + 1));
+        out += value;
+        out += '\0';
+    }
+
+    void appendPropertyHeader(std::string &out, std::string_view name, std::string_view type, std::size_t size) {
+        appendFString(out, name);
+        appendFString(out, type);
+        appendInt64(out, static_cast<std::int64_t>(size));
+    }
+
+    std::string strProperty(std::string_view name, std::string_view value) {
+        std::string result, data;
+        appendFString(data, value);
+        appendPropertyHeader(result, name, "StrProperty", data.length());
+        result += '\0';
+        return result + data;
+    }
+
+    std::string structProperty(std::string_view name, std::string_view structType, std::string_view data) {
+        std::string result;
+        appendPropertyHeader(result, name, "StructProperty", data.length());
+        appendFString(result, structType);
+        result.append(17, '\0'); // Struct GUID and property GUID flag
+        result += data;
+        return result;
+    }
+
+    std::string byteArrayProperty(std::string_view name, std::string_view bytes) {
+        std::string result;
+        appendPropertyHeader(result, name, "ArrayProperty", bytes.length() + 4);
+        appendFString(result, "ByteProperty");
+        result += '\0';
+        appendInt32(result, static_cast<std::int32_t>(bytes.length()));
+        result += bytes;
+        return result;
+    }
+
+    // Wraps a database image in a GVAS save with a character, like the game's saves
+    std::string makeGvas(std::string_view dbImage, NoiseSource &noise) {
+        std::string save = MAGIC_HEADER;
+        appendInt32(save, 2);   // Save game version
+        appendInt32(save, 522); // Package version
+        for (int part : {4, 27, 2}) {
+            save += static_cast<char>(part);
+            save += '\0';
+        }
+        appendInt32(save, 0); // Changelist
+        appendFString(save, "++UE4+Release-4.27");
+        appendInt32(save, 3); // Custom version format
+        appendInt32(save, 2); // Custom versions
+        for (int version : {1, 5}) {
+            for (int i = 0; i < 16; i++) save += static_cast<char>(noise.below(256));
+            appendInt32(save, version);
+        }
+        appendFString(save, "/Script/Phoenix.PhoenixSaveGame");
+        std::string playerInfo = strProperty("CharacterName", "Synthetic Wizard") + strProperty("CharacterHouse", "Ravenclaw");
+        std::string location;
+        appendInt32(location, 0);
+        appendInt32(location, 0);
+        appendInt32(location, 0);
+        playerInfo += structProperty("Location", "Vector", location);
+        appendFString(playerInfo, "None");
+        std::string version;
+        appendInt32(version, 3);
+        appendPropertyHeader(save, "SaveVersion", "IntProperty", version.length());
+        save += '\0';
+        save += version;
+        save += structProperty("PlayerInfo", "PlayerInfoStruct", playerInfo);
+        save += byteArrayProperty(DB_IMAGE_STR, dbImage);
+        save += byteArrayProperty("RawExclusiveImage", noise.text(1000));
+        appendFString(save, "None");
+        appendInt32(save, 0);
+        return save;
+    }
+
+    unsigned long long readBigEndian(std::string_view bytes, unsigned long long offset, int length) {
+        unsigned long long result = 0;
+        for (int i = 0; i < length; i++) result = result << 8 | static_cast<unsigned char>(bytes[offset + i]);
+        return result;
+    }
+
+    // Overwrites the type byte of a table's root page or first leaf page, and returns whether it was found
+    bool corruptPage(std::string &image, const SyntheticDamage &damage, std::string &error) {
+        DBReader reader(image);
+        DBTable table;
+        if (!reader.valid() || !reader.findTable(damage.table, table)) {
+            error = "There is no table \"" + damage.table + "\" to damage";
+            return false;
+        }
+        unsigned long long pageSize = readBigEndian(image, 16, 2);
+        if (pageSize == 1) pageSize = 65536;
+        unsigned long long page = table.rootPage;
+        for (int depth = 0; depth < DB_MAX_TREE_DEPTH; depth++) {
+            unsigned long long header = (page - 1) * pageSize + (page == 1 ? DB_HEADER_SIZE : 0);
+            if (header + 12 > image.length()) break;
+            // Interior table pages lead to their first child through their first cell, which starts with its page number
+            if (damage.kind == CorruptLeafPage && image[header] == 0x05) {
+                unsigned long long cell = (page - 1) * pageSize + readBigEndian(image, header + 12, 2);
+                page = readBigEndian(image, cell, 4);
+                continue;
+            }
+            image[header] = 0;
+            return true;
+        }
+        error = "The pages of table \"" + damage.table + "\" couldn't be followed";
+        return false;
+    }
+}
+
+bool makeSyntheticSave(const SyntheticSaveOptions &options, std::string &save, CollectibleSet &collected, std::string &error) {
+    NoiseSource noise(options.seed);
+    DBWriter db;
+    if (!db.open(error)) return false;
+    // Interleave noise with collectibles, so neither ends up in pages of its own
+    unsigned long noisePerCollectible = options.noiseRows / collectibles.size();
+    unsigned long noiseLeft = options.noiseRows;
+    collected.reset();
+    std::string finishingTouches;
+    for (int i = 0; i < collectibles.size(); i++) {
+        const CollectibleStruct &collectible = collectibles[i];
+        auto fraction = options.collectedByType.find(collectible.type);
+        collected[i] = noise.chance(fraction == options.collectedByType.end() ? options.collected : fraction->second);
+        addCollectibleRow(db, noise, collectible, collected[i], finishingTouches);
+        for (unsigned long j = 0; j < noisePerCollectible; j++, noiseLeft--) addNoiseRow(db, noise);
+    }
+    for (; noiseLeft > 0; noiseLeft--) addNoiseRow(db, noise);
+    db.insert(AchievementDynamic, "PFA_43", (long long) finishingTouches.size(), finishingTouches);
+    // A conjuration for every chest that gives one, and the butterfly quest only once its chest is collected, so neither bug is detected
+    unsigned long conjurations = 0;
+    for (CollectibleEnum type : conjurationChestTypes) conjurations += (collected & getTypeMask(type)).count();
+    for (unsigned long i = 0; i < conjurations; i++) {
+        db.insert(CollectionDynamic, "Conjuration_" + std::to_string(i), "Conjurations", "Exploration", "Obtained", (long long) noise.below(1000000));
+    }
+    for (int i = 0; i < collectibles.size(); i++) {
+        if (collectibles[i].type == ButterflyChest && collectibles[i].index == "1" && collected[i]) db.insert(PlayerStatsDynamic, "COM_11", "Complete");
+    }
+    std::string image;
+    if (!db.serialize(image, error)) return false;
+    for ( const auto &damage : options.damage ) {
+        if (damage.kind == CorruptHeader) {
+            image.replace(0, 6, "Broken");
+        } else if (!corruptPage(image, damage, error)) {
+            return false;
+        }
+    }
+    save = makeGvas(image, noise);
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef LEGILIMENS_HOGWARTS_LEGACY_CPP_SYNTHETICSAVE_H
+#define LEGILIMENS_HOGWARTS_LEGACY_CPP_SYNTHETICSAVE_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../collectibles.h"
+
+// Builds saves that look like Hogwarts Legacy's to Legilimens: a GVAS file whose RawDatabaseImage property is a SQLite
+// database with the tables Legilimens reads. Collectibles are marked collected like the game does, among rows that aren't
+// collectibles, so saves of any size and completion can be benchmarked without needing real ones
+
+// Damage done to the database after it's built
+enum SyntheticCorruption {
+    CorruptRootPage, // The root page of a table, so none of it can be read
+    CorruptLeafPage, // The first leaf page of a table, so only part of it can be read
+    CorruptHeader    // The database header, so it can't be opened at all
+};
+
+struct SyntheticDamage {
+    SyntheticCorruption kind;
+    std::string table; // Not used by CorruptHeader
+};
+
+struct SyntheticSaveOptions {
+    double collected = 0.5; // Fraction of each type's collectibles that are collected
+    std::unordered_map<CollectibleEnum, double> collectedByType; // Overrides collected for these types
+    unsigned long noiseRows = 20000; // Rows that aren't collected collectibles, spread over the tables roughly like a real save
+    unsigned int seed = 1;
+    std::vector<SyntheticDamage> damage;
+};
+
+// Builds a save, and returns whether it was successful. Otherwise error says what went wrong
+// collected is set to the collectibles the save has collected, which is what Legilimens should find if it isn't damaged
+bool makeSyntheticSave(const SyntheticSaveOptions &options, std::string &save, CollectibleSet &collected, std::string &error);
+
+#endif //LEGILIMENS_HOGWARTS_LEGACY_CPP_SYNTHETICSAVE_H
@@ -0,0 +1,120 @@
+// Compares writing the missing collectible tables with tabulate, like Legilimens used to, against ResultTable,
+// for a report with every collectible missing, sorted by region and by type
+// Usage: TableBenchmark [iterations]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "../collectibles.h"
+#include "../getsave.h"
+#include "../output.h"
+#include "../report.h"
+#include "../tabulate.hpp"
+
+namespace {
+    tabulate::Color getTabulateColor(const CollectibleType &type) {
+        if (type.timestampName == "Field guide page") return tabulate::Color::cyan;
+        if (type.timestampName == "Demiguise Moon") return tabulate::Color::blue;
+        if (type.timestampName == "Merlin Trial") return tabulate::Color::green;
+        if (type.timestampName == "Butterfly Chest") return tabulate::Color::yellow;
+        if (type.timestampName == "Collection Chest") return tabulate::Color::magenta;
+        return tabulate::Color::white;
+    }
+
+    tabulate::Table getHeaderTable(const std::string &text) {
+        tabulate::Table table;
+        table.add_row({text});
+        table[0].format().font_align(tabulate::FontAlign::center).hide_border().width(TABLE_WIDTH).padding_bottom(0);
+        return table;
+    }
+
+    // The tables as Legilimens used to build them
+    void writeWithTabulate(std::ostream &stream, const CollectibleSet &shown, bool sortByType) {
+        if (sortByType) {
+            for (int type = 0; type < collectibleTypes.size(); type++) {
+                CollectibleSet missingOfType = shown & getTypeMask(CollectibleEnum(type));
+                if (missingOfType.none()) continue;
+                const CollectibleType &info = collectibleTypes[type];
+                std::string header(info.sortByTypeName);
+                if (header.empty()) header = info.timeStampParen.empty() ? std::string(info.timestampName) : std::string(info.timestampName) + " - " + std::string(info.timeStampParen);
+                tabulate::Table headerTable = getHeaderTable(header);
+                tabulate::Table table;
+                table.add_row({"Item", "Location"});
+                table.column(0).format().width(TABLE_WIDTH - 37 - 1);
+                table.column(1).format().width(37);
+                for (int i = 0; i < collectibles.size(); i++) {
+                    if (!missingOfType.test(i)) continue;
+                    const CollectibleStruct &collectible = collectibles[i];
+                    std::string name(collectible.index);
+                    if (collectible.type != FinishingTouchEnemy) name = std::string(regions[collectible.region].name) + " #" + name;
+                    std::string video = getVideoUrl(collectible);
+                    if (video.empty()) video = "No video yet";
+                    table.add_row({name, video});
+                    table[table.size()-1].format().font_color(getTabulateColor(info));
+                }
+                table.column(1).format().font_align(tabulate::FontAlign::center);
+                stream << std::endl << std::endl << headerTable << std::endl << table << std::endl;
+            }
+        } else {
+            for (int region = 0; region < regions.size(); region++) {
+                CollectibleSet missingInRegion = shown & getRegionMask(RegionEnum(region));
+                if (missingInRegion.none()) continue;
+                const RegionStruct &info = regions[region];
+                tabulate::Table headerTable = getHeaderTable(info.globalRegion.empty() ? std::string(info.name) : std::string(info.globalRegion) + " - " + std::string(info.name));
+                tabulate::Table table;
+                table.add_row({"Item", "Type", "Location"});
+                table.column(0).format().width(27);
+                table.column(1).format().width(TABLE_WIDTH - 64 - 2);
+                table.column(2).format().width(37);
+                for (int i = 0; i < collectibles.size(); i++) {
+                    if (!missingInRegion.test(i)) continue;
+                    const CollectibleStruct &collectible = collectibles[i];
+                    const CollectibleType &type = collectibleTypes[collectible.type];
+                    std::string name(collectible.index);
+                    if (collectible.type != FinishingTouchEnemy) name = std::string(type.timestampName) + " #" + name;
+                    std::string video = getVideoUrl(collectible);
+                    if (video.empty()) video = "No video yet";
+                    table.add_row({name, std::string(type.timeStampParen), video});
+                    table[table.size()-1].format().font_color(getTabulateColor(type));
+                }
+                table.column(1).format().font_align(tabulate::FontAlign::center);
+                stream << std::endl << std::endl << headerTable << std::endl << table << std::endl;
+            }
+        }
+    }
+
+    // Renders the report iterations times into a colorized buffer, like Output does, and returns the milliseconds per report
+    template <typename Write>
+    double timeReport(const CollectibleSet &shown, bool sortByType, unsigned long iterations, Write write, std::string &result) {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned long i = 0; i < iterations; i++) {
+            std::ostringstream buffer;
+            buffer << termcolor::colorize;
+            write(buffer, shown, sortByType);
+            result = buffer.str();
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / static_cast<double>(iterations);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long iterations = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 20;
+    CollectibleSet shown;
+    shown.set();
+    for (bool sortByType : {false, true}) {
+        std::string tabulateResult, resultTableResult;
+        double tabulateTime = timeReport(shown, sortByType, iterations, writeWithTabulate, tabulateResult);
+        double resultTableTime = timeReport(shown, sortByType, iterations, writeMissingTables, resultTableResult);
+        // Colors are written differently, but what's left once they're stripped must be byte for byte the same
+        if (stripColors(tabulateResult) != stripColors(resultTableResult)) {
+            std::cerr << "tabulate and ResultTable wrote different tables" << std::endl;
+            return 1;
+        }
+        std::cout << (sortByType ? "Sorted by type" : "Sorted by region") << ", " << shown.count() << " collectibles, " << iterations << " iterations" << std::endl;
+        std::cout << "tabulate:    " << tabulateTime << " ms per report (" << tabulateResult.length() << " bytes)" << std::endl;
+        std::cout << "ResultTable: " << resultTableTime << " ms per report (" << resultTableResult.length() << " bytes, " << tabulateTime / resultTableTime << "x faster)" << std::endl;
+    }
+    return 0;
+}
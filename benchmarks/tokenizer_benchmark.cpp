@@ -0,0 +1,64 @@
+// Compares splitting a long OneOfEach list with std::regex, like Legilimens used to, against Tokenizer
+// Usage: TokenizerBenchmark [entries] [iterations]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <regex>
+#include <string>
+#include <unordered_set>
+#include "../tokens.h"
+
+namespace {
+    // Builds a comma separated list like AchievementDynamic's OneOfEach column, with some entries repeated
+    std::string makeList(unsigned long entries) {
+        static const char *const kinds[] = {"Troll", "Goblin", "Spider", "Poacher", "DarkWizard", "Inferius", "Ashwinder", "Pensieve"};
+        std::string list;
+        for (unsigned long i = 0; i < entries; i++) {
+            if (i > 0) list += ", ";
+            list += "Enemy_" + std::string(kinds[i % 8]) + "_" + std::to_string(i % (entries / 2 + 1));
+        }
+        return list;
+    }
+
+    void splitWithRegex(const std::string &list, std::unordered_set<std::string> &result) {
+        static const std::regex re("\\w+");
+        std::string commaSepList(list);
+        for (std::sregex_iterator i = std::sregex_iterator(commaSepList.begin(), commaSepList.end(), re); i != std::sregex_iterator(); i++) {
+            result.insert(i->str());
+        }
+    }
+
+    void splitWithTokenizer(const std::string &list, std::unordered_set<std::string> &result) {
+        Tokenizer entries(list, isWordChar);
+        std::string_view entry;
+        while (entries.next(entry)) result.emplace(entry);
+    }
+
+    template <typename Split>
+    double timeSplit(const std::string &list, unsigned long iterations, Split split, std::unordered_set<std::string> &result) {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned long i = 0; i < iterations; i++) {
+            result.clear();
+            split(list, result);
+        }
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / static_cast<double>(iterations);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long entries = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 2000;
+    unsigned long iterations = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 200;
+    std::string list = makeList(entries);
+    std::unordered_set<std::string> regexResult, tokenizerResult;
+    double regexTime = timeSplit(list, iterations, splitWithRegex, regexResult);
+    double tokenizerTime = timeSplit(list, iterations, splitWithTokenizer, tokenizerResult);
+    if (regexResult != tokenizerResult) {
+        std::cerr << "Tokenizer and std::regex found different entries" << std::endl;
+        return 1;
+    }
+    std::cout << entries << " entries (" << list.length() << " bytes, " << regexResult.size() << " unique), " << iterations << " iterations" << std::endl;
+    std::cout << "std::regex: " << regexTime << " us per list" << std::endl;
+    std::cout << "Tokenizer:  " << tokenizerTime << " us per list (" << regexTime / tokenizerTime << "x faster)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,110 @@
+#ifndef LEGILIMENS_HOGWARTS_LEGACY_CPP_COLLECTIBLEKEY_H
+#define LEGILIMENS_HOGWARTS_LEGACY_CPP_COLLECTIBLEKEY_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+#define GUID_KEY_LENGTH 32
+
+// A collectible key that's been parsed but not copied, for looking keys up without allocating
+// Keys that are GUIDs written as 32 uppercase hex digits, like butterfly chests and Merlin trials, are packed into two words.
+// Anything else, including lowercase hex, is compared by its text, so two keys are only equal if their text is
+// Parsing is constexpr so the catalog's keys are parsed at compile time, see collectibles.cpp
+struct CollectibleKeyView {
+    bool guid = false;
+    unsigned long long high = 0;
+    unsigned long long low = 0;
+    std::string_view text; // Not compared for GUIDs, and may be empty for them
+
+    constexpr CollectibleKeyView() = default;
+    constexpr CollectibleKeyView(const char *key) : CollectibleKeyView(std::string_view(key)) {}
+    constexpr explicit CollectibleKeyView(std::string_view key) : text(key) {
+        if (key.length() != GUID_KEY_LENGTH) return;
+        for (int i = 0; i < GUID_KEY_LENGTH; i++) {
+            char c = key[i];
+            unsigned long long digit;
+            if (c >= '0' && c <= '9') {
+                digit = c - '0';
+            } else if (c >= 'A' && c <= 'F') {
+                digit = c - 'A' + 10;
+            } else {
+                high = low = 0;
+                return;
+            }
+            unsigned long long &word = (i < GUID_KEY_LENGTH / 2) ? high : low;
+            word = word << 4 | digit;
+        }
+        guid = true;
+    }
+
+    constexpr bool operator==(const CollectibleKeyView &other) const {
+        return guid ? (other.guid && high == other.high && low == other.low) : (!other.guid && text == other.text);
+    }
+};
+
+// A collectible key, or a query result that might be one, see CollectibleKeyView
+class CollectibleKey {
+public:
+    CollectibleKey() = default;
+    explicit CollectibleKey(const CollectibleKeyView &key) : guid(key.guid), high(key.high), low(key.low), text(key.guid ? std::string_view() : key.text) {}
+    CollectibleKey(std::string_view key) : CollectibleKey(CollectibleKeyView(key)) {}
+    CollectibleKey(const char *key) : CollectibleKey(std::string_view(key)) {}
+    CollectibleKey(const std::string &key) : CollectibleKey(std::string_view(key)) {}
+
+    CollectibleKeyView view() const {
+        CollectibleKeyView result;
+        result.guid = guid;
+        result.high = high;
+        result.low = low;
+        result.text = text;
+        return result;
+    }
+    bool isGuid() const { return guid; }
+    // The key as it's written in the save
+    std::string str() const {
+        if (!guid) return text;
+        static const char hexDigits[] = "0123456789ABCDEF";
+        std::string result(GUID_KEY_LENGTH, '0');
+        for (int i = 0; i < GUID_KEY_LENGTH / 2; i++) {
+            result[i] = hexDigits[(high >> (60 - 4 * i)) & 0xF];
+            result[GUID_KEY_LENGTH / 2 + i] = hexDigits[(low >> (60 - 4 * i)) & 0xF];
+        }
+        return result;
+    }
+
+    bool operator==(const CollectibleKey &other) const { return view() == other.view(); }
+
+private:
+    bool guid = false;
+    unsigned long long high = 0;
+    unsigned long long low = 0;
+    std::string text; // Empty for GUIDs, which are only stored packed
+};
+
+// Hashes and compares keys and views of keys, so sets of keys can be searched with a view
+struct CollectibleKeyHash {
+    using is_transparent = void;
+
+    std::size_t operator()(const CollectibleKeyView &key) const {
+        // GUIDs are random, so mixing their two words is enough
+        if (key.guid) return static_cast<std::size_t>(key.high ^ (key.low * 0x9E3779B97F4A7C15ULL));
+        return std::hash<std::string_view>()(key.text);
+    }
+    std::size_t operator()(const CollectibleKey &key) const { return (*this)(key.view()); }
+};
+
+struct CollectibleKeyEqual {
+    using is_transparent = void;
+
+    bool operator()(const CollectibleKeyView &a, const CollectibleKeyView &b) const { return a == b; }
+    bool operator()(const CollectibleKey &a, const CollectibleKeyView &b) const { return a.view() == b; }
+    bool operator()(const CollectibleKeyView &a, const CollectibleKey &b) const { return a == b.view(); }
+    bool operator()(const CollectibleKey &a, const CollectibleKey &b) const { return a.view() == b.view(); }
+};
+
+using KeySet = std::unordered_set<CollectibleKey, CollectibleKeyHash, CollectibleKeyEqual>;
+
+#endif //LEGILIMENS_HOGWARTS_LEGACY_CPP_COLLECTIBLEKEY_H
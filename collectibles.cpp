@@ -1,7 +1,10 @@
 #include "collectibles.h"
+#include <algorithm>
+#include <bit>
+#include <vector>
 
 // Maps from CollectibleEnum
-const std::vector<CollectibleType> collectibleTypes = {
+constexpr CollectibleType collectibleTypeList[] = {
         { "Revelio", "Field guide page", "Revelio", "", CollectionDynamic },
         { "Flying", "Field guide page", "Flying", "", MapLocationDataDynamic },
         { "Moth", "Field guide page", "Moth painting", "", MiscDataDynamic },
@@ -26,20 +29,20 @@ const std::vector<CollectibleType> collectibleTypes = {
 };
 
 // Maps from TableEnum
-const std::vector<QueryStruct> tables = {
-        {"SELECT ItemID FROM CollectionDynamic WHERE ItemState='Obtained';", false, {"Revelio field guide pages"}},
-        {"SELECT SphinxPuzzleGUID FROM SphinxPuzzleDynamic WHERE EInteractiveState=34;", false, {"Merlin trials"}},
-        {"SELECT LootGroup FROM LootDropComponentDynamic;", false, {"Vivarium chests"}},
-        {"SELECT UniqueID FROM EconomicExpiryDynamic;", false, {"Butterfly chests"}},
-        {"SELECT DataName FROM MiscDataDynamic WHERE DataValue='1';", false, {"Brazier/Moth/Statue field guide pages", "Daedalian Key"}},
-        {"SELECT MapLocationID FROM MapLocationDataDynamic WHERE State=11;", false, {"Flying field guide pages", "Collection Chests", "Demiguise Moons", "Balloon Sets", "Landing Platforms", "Astronomy Tables", "Ancient Magic Hotspots", "Infamous Foes"}},
-        {"SELECT OneOfEach FROM AchievementDynamic WHERE AchievementID='PFA_43';", true, {"Finishing Touches enemies"}},
-        {"SELECT ActivityName FROM PlayerStatsDynamic WHERE ActivityValue='Complete';", false, {"Butterfly quest bug detector"}},
-        {"SELECT ItemID FROM CollectionDynamic WHERE ItemState='Obtained' AND SubcategoryID='Exploration' AND CategoryID='Conjurations';", false, {"Conjuration bug detector"}}
+constexpr QueryStruct tableList[] = {
+        {"CollectionDynamic", "ItemID", "ItemState='Obtained'", false, true, {"Revelio field guide pages"}},
+        {"SphinxPuzzleDynamic", "SphinxPuzzleGUID", "EInteractiveState=34", false, true, {"Merlin trials"}},
+        {"LootDropComponentDynamic", "LootGroup", "", false, true, {"Vivarium chests"}},
+        {"EconomicExpiryDynamic", "UniqueID", "", false, true, {"Butterfly chests"}},
+        {"MiscDataDynamic", "DataName", "DataValue='1'", false, true, {"Brazier/Moth/Statue field guide pages", "Daedalian Key"}},
+        {"MapLocationDataDynamic", "MapLocationID", "State=11", false, true, {"Flying field guide pages", "Collection Chests", "Demiguise Moons", "Balloon Sets", "Landing Platforms", "Astronomy Tables", "Ancient Magic Hotspots", "Infamous Foes"}},
+        {"AchievementDynamic", "OneOfEach", "AchievementID='PFA_43'", true, false, {"Finishing Touches enemies"}},
+        {"PlayerStatsDynamic", "ActivityName", "ActivityValue='Complete'", false, false, {"Butterfly quest bug detector"}},
+        {"CollectionDynamic", "ItemID", "ItemState='Obtained' AND SubcategoryID='Exploration' AND CategoryID='Conjurations'", false, false, {"Conjuration bug detector"}}
 };
 
 // Maps from RegionEnum
-const std::vector<RegionStruct> regions = {
+constexpr RegionStruct regionList[] = {
         { "Butterflies", "" },
         { "Daedalian Keys", "" },
         { "Hogsmeade", "" },
@@ -68,9 +71,9 @@ const std::vector<RegionStruct> regions = {
 };
 
 // Maps from CollectibleStruct.video
-const std::string videoIds[] = { "na_PmDfcgs8", "TmJz8SdyIBk", "KnHZ5gVb_qk", "ujZ2ri9NWT0", "N7qlkJ_X_GM", "-UXr4u2lCyI", "zFQnNOiRKc4", "JgmGuUtmNpU", "5YFrI_xahlE", "wsEFQuug8To", "M8lTSHCqKj0", "2bwmWe9Wtl0", "DgldMhGeCyU", "Q5KxxxA0aGs", "E7mo2BZHa4Q", "eTcCMO2FEsQ", "fEd5v0gjvpQ", "rJAZM882ruM", "6opEItpQCjI", "gYs24rpRPZ0", "XFvSJbUJU9A", "P1nYcWHPAMU", "ydm1hlweOTU", "ImMInXddlXE", "lAzaoDebGVM", "3rTORHz1yPM"};
+constexpr std::string_view videoIdList[] = { "na_PmDfcgs8", "TmJz8SdyIBk", "KnHZ5gVb_qk", "ujZ2ri9NWT0", "N7qlkJ_X_GM", "-UXr4u2lCyI", "zFQnNOiRKc4", "JgmGuUtmNpU", "5YFrI_xahlE", "wsEFQuug8To", "M8lTSHCqKj0", "2bwmWe9Wtl0", "DgldMhGeCyU", "Q5KxxxA0aGs", "E7mo2BZHa4Q", "eTcCMO2FEsQ", "fEd5v0gjvpQ", "rJAZM882ruM", "6opEItpQCjI", "gYs24rpRPZ0", "XFvSJbUJU9A", "P1nYcWHPAMU", "ydm1hlweOTU", "ImMInXddlXE", "lAzaoDebGVM", "3rTORHz1yPM"};
 
-const std::vector<Filter> filterOptions = {
+constexpr Filter filterOptionList[] = {
         {"ALL", "Everything", {}},
         {"PAGES", "Field Guide Pages", {Revelio, Flying, Moth, Brazier, Statue}},
         {"CHESTS", "Collection Chests", {ButterflyChest, VivariumChest, MiscWandChest, MiscConjChest, ArithmancyChest, DungeonChest, CampChest}},
@@ -90,7 +93,7 @@ const std::vector<Filter> filterOptions = {
 };
 
 // List of all collectibles
-const std::vector<CollectibleStruct> collectibles = {
+constexpr CollectibleStruct collectibleList[] = {
         { ButterflyChest, "6B564A7340A0AC3DCDBFD3913BFBA38A", 23, 0, Butterflies, "1" },
         { ButterflyChest, "020CB382495B83FF10AE92989DCD2224", 23, 26, Butterflies, "2" },
         { ButterflyChest, "3D831435444EE51F708EE6A52F50A90B", 23, 74, Butterflies, "3" },
@@ -791,3 +794,133 @@ const std::vector<CollectibleStruct> collectibles = {
         { FinishingTouchEnemy, "SpiderWoodlouseSniper", 25, 1597, FinishingTouches, "Thornback Ambusher" },
         { FinishingTouchEnemy, "SpiderVenomousSniper", 25, 1644, FinishingTouches, "Venomous Ambusher" },
 };
+
+const std::span<const CollectibleType> collectibleTypes(collectibleTypeList);
+const std::span<const QueryStruct> tables(tableList);
+const std::span<const RegionStruct> regions(regionList);
+const std::span<const std::string_view> videoIds(videoIdList);
+const std::span<const Filter> filterOptions(filterOptionList);
+const std::span<const CollectibleStruct> collectibles(collectibleList);
+
+namespace {
+    constexpr std::size_t collectibleCount = std::size(collectibleList);
+    static_assert(collectibleCount == COLLECTIBLE_COUNT, "COLLECTIBLE_COUNT must be the number of collectibles");
+    // Keys are first hashed into buckets of a few keys each, then each bucket gets the first seed that puts its keys in empty slots
+    constexpr std::size_t hashBuckets = std::bit_ceil(collectibleCount) / 4;
+    constexpr std::size_t hashSlots = std::bit_ceil(collectibleCount);
+
+    // Hashes a key like CollectibleKeyHash, but with a seed and usable at compile time
+    constexpr unsigned long long hashKey(const CollectibleKeyView &key, unsigned long long seed) {
+        unsigned long long hash = seed * 0x9E3779B97F4A7C15ULL;
+        if (key.guid) {
+            hash ^= key.high + 0x632BE59BD9B4E019ULL + (hash << 6) + (hash >> 2);
+            hash ^= key.low + 0x632BE59BD9B4E019ULL + (hash << 6) + (hash >> 2);
+        } else {
+            // FNV-1a
+            hash ^= 0xCBF29CE484222325ULL;
+            for (char c : key.text) hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001B3ULL;
+        }
+        // splitmix64 finalizer
+        hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+        return hash ^ (hash >> 31);
+    }
+
+    struct CollectibleIndex {
+        std::array<unsigned short, hashBuckets> seeds{};
+        std::array<short, hashSlots> slots{}; // Indices into collectibles, -1 for empty slots
+    };
+
+    constexpr CollectibleIndex buildCollectibleIndex() {
+        CollectibleIndex index;
+        index.slots.fill(-1);
+        // Group the collectibles by bucket, bucket b's are byBucket[bucketStart[b]] to byBucket[bucketStart[b + 1]]
+        std::array<std::size_t, hashBuckets + 1> bucketStart{};
+        for (const auto &collectible : collectibleList) bucketStart[hashKey(collectible.key, 0) % hashBuckets + 1]++;
+        for (std::size_t bucket = 0; bucket < hashBuckets; bucket++) bucketStart[bucket + 1] += bucketStart[bucket];
+        std::array<std::size_t, collectibleCount> byBucket{};
+        std::array<std::size_t, hashBuckets> filled{};
+        for (std::size_t i = 0; i < collectibleCount; i++) {
+            std::size_t bucket = hashKey(collectibleList[i].key, 0) % hashBuckets;
+            byBucket[bucketStart[bucket] + filled[bucket]++] = i;
+        }
+        std::size_t largestBucket = 0;
+        for (std::size_t size : filled) largestBucket = std::max(largestBucket, size);
+        if (largestBucket > 16) throw "Too many collectible keys in one bucket";
+        // Largest buckets first, while there are still plenty of empty slots
+        for (std::size_t size = largestBucket; size > 0; size--) {
+            for (std::size_t bucket = 0; bucket < hashBuckets; bucket++) {
+                if (filled[bucket] != size) continue;
+                const std::size_t *members = byBucket.data() + bucketStart[bucket];
+                for (std::size_t i = 0; i < size; i++) {
+                    for (std::size_t j = 0; j < i; j++) {
+                        if (collectibleList[members[i]].key == collectibleList[members[j]].key) throw "Collectible keys must be unique";
+                    }
+                }
+                std::array<std::size_t, 16> slots{};
+                unsigned short seed = 0;
+                for (bool fits = false; !fits; ) {
+                    if (++seed == 0) throw "No perfect hash seed for a bucket of collectible keys";
+                    fits = true;
+                    for (std::size_t i = 0; fits && i < size; i++) {
+                        slots[i] = hashKey(collectibleList[members[i]].key, seed) % hashSlots;
+                        fits = index.slots[slots[i]] == -1;
+                        for (std::size_t j = 0; fits && j < i; j++) fits = slots[i] != slots[j];
+                    }
+                }
+                index.seeds[bucket] = seed;
+                for (std::size_t i = 0; i < size; i++) index.slots[slots[i]] = static_cast<short>(members[i]);
+            }
+        }
+        return index;
+    }
+
+    constexpr CollectibleIndex collectibleIndex = buildCollectibleIndex();
+
+    constexpr bool indexIsComplete() {
+        for (std::size_t i = 0; i < collectibleCount; i++) {
+            const CollectibleKeyView &key = collectibleList[i].key;
+            std::size_t slot = hashKey(key, collectibleIndex.seeds[hashKey(key, 0) % hashBuckets]) % hashSlots;
+            if (collectibleIndex.slots[slot] != static_cast<short>(i)) return false;
+        }
+        return true;
+    }
+    static_assert(indexIsComplete(), "Every collectible must be found by its key");
+}
+
+namespace {
+    // Builds a mask for every value of an enum, from the value each collectible has
+    template <typename Value>
+    std::vector<CollectibleSet> buildMasks(std::size_t count, Value value) {
+        std::vector<CollectibleSet> masks(count);
+        for (std::size_t i = 0; i < collectibleCount; i++) masks[value(collectibleList[i])].set(i);
+        return masks;
+    }
+}
+
+const CollectibleSet &getTypeMask(CollectibleEnum type) {
+    static const std::vector<CollectibleSet> masks = buildMasks(std::size(collectibleTypeList), [](const CollectibleStruct &collectible) {
+        return collectible.type;
+    });
+    return masks[type];
+}
+
+const CollectibleSet &getRegionMask(RegionEnum region) {
+    static const std::vector<CollectibleSet> masks = buildMasks(std::size(regionList), [](const CollectibleStruct &collectible) {
+        return collectible.region;
+    });
+    return masks[region];
+}
+
+const CollectibleSet &getTableMask(TableEnum table) {
+    static const std::vector<CollectibleSet> masks = buildMasks(std::size(tableList), [](const CollectibleStruct &collectible) {
+        return collectibleTypeList[collectible.type].table;
+    });
+    return masks[table];
+}
+
+int findCollectible(const CollectibleKeyView &key) {
+    std::size_t slot = hashKey(key, collectibleIndex.seeds[hashKey(key, 0) % hashBuckets]) % hashSlots;
+    int found = collectibleIndex.slots[slot];
+    return (found >= 0 && collectibleList[found].key == key) ? found : -1;
+}
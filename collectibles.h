@@ -1,9 +1,17 @@
 #ifndef LEGILIMENS_HOGWARTS_LEGACY_CPP_COLLECTIBLES_H
 #define LEGILIMENS_HOGWARTS_LEGACY_CPP_COLLECTIBLES_H
 
-#include <string>
-#include <vector>
-#include <map>
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <string_view>
+#include "collectiblekey.h"
+
+// The catalog below is constexpr data, so none of it is built or allocated at startup
+#define COLLECTIBLE_COUNT 699
 
 enum CollectibleEnum {
     Revelio = 0,
@@ -69,45 +77,81 @@ enum RegionEnum {
     FinishingTouches = 24
 };
 
+// A list of at most N items that can be written like a vector in constexpr data
+template <typename T, std::size_t N>
+struct FixedList {
+    std::array<T, N> items{};
+    std::size_t count = 0;
+
+    constexpr FixedList() = default;
+    constexpr FixedList(std::initializer_list<T> list) : count(list.size()) {
+        if (list.size() > N) throw "Too many items for FixedList";
+        std::size_t i = 0;
+        for (const T &item : list) items[i++] = item;
+    }
+
+    constexpr const T *begin() const { return items.data(); }
+    constexpr const T *end() const { return items.data() + count; }
+    constexpr std::size_t size() const { return count; }
+    constexpr bool empty() const { return count == 0; }
+};
+
 struct CollectibleStruct {
     CollectibleEnum type;
-    std::string key;
+    CollectibleKeyView key; // Parsed at compile time, its text is key.text
     uint8_t video;
     uint16_t timestamp;
     RegionEnum region;
-    std::string index;
+    std::string_view index;
 };
 
 struct Filter {
-    std::string cli;
-    std::string name;
-    std::vector<CollectibleEnum> types;
+    std::string_view cli;
+    std::string_view name;
+    FixedList<CollectibleEnum, 8> types;
 };
 
 struct CollectibleType {
-    std::string name;
-    std::string timestampName;
-    std::string timeStampParen;
-    std::string sortByTypeName;
+    std::string_view name;
+    std::string_view timestampName;
+    std::string_view timeStampParen;
+    std::string_view sortByTypeName;
     TableEnum table;
 };
 
+// A query of the form "SELECT column FROM table WHERE condition;"
+// Queries on the same table are merged into a single scan, see analysis.cpp
 struct QueryStruct {
-    std::string query;
+    std::string_view table;
+    std::string_view column;
+    std::string_view condition; // Empty to select every row
     bool oneRow;
-    std::vector<std::string> affected;
+    bool keysOnly; // Whether the results are only ever looked up by collectible key, so SQLite only needs to return those
+    FixedList<std::string_view, 8> affected;
 };
 
 struct RegionStruct {
-    std::string name;
-    std::string globalRegion;
+    std::string_view name;
+    std::string_view globalRegion;
 };
 
-extern const std::vector<CollectibleType> collectibleTypes;
-extern const std::vector<QueryStruct> tables;
-extern const std::vector<RegionStruct> regions;
-extern const std::string videoIds[];
-extern const std::vector<Filter> filterOptions;
-extern const std::vector<CollectibleStruct> collectibles;
+extern const std::span<const CollectibleType> collectibleTypes;
+extern const std::span<const QueryStruct> tables;
+extern const std::span<const RegionStruct> regions;
+extern const std::span<const std::string_view> videoIds;
+extern const std::span<const Filter> filterOptions;
+extern const std::span<const CollectibleStruct> collectibles;
+
+// A set of collectibles, as bits indexed by their position in collectibles
+using CollectibleSet = std::bitset<COLLECTIBLE_COUNT>;
+
+// Every collectible of a type, in a region, or whose key is looked up in a table
+const CollectibleSet &getTypeMask(CollectibleEnum type);
+const CollectibleSet &getRegionMask(RegionEnum region);
+const CollectibleSet &getTableMask(TableEnum table);
+
+// Gets the index in collectibles of the collectible with this key, -1 if there isn't one
+// Uses a perfect hash built at compile time, so it's a single probe without collisions
+int findCollectible(const CollectibleKeyView &key);
 
 #endif //LEGILIMENS_HOGWARTS_LEGACY_CPP_COLLECTIBLES_H
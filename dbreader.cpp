@@ -0,0 +1,481 @@
+#include "dbreader.h"
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstring>
+#include "getsave.h"
+
+#define DB_LEAF_TABLE_PAGE 0x0D
+#define DB_INTERIOR_TABLE_PAGE 0x05
+#define DB_UNOWNED_PAGE (-1)
+#define DB_OTHER_PAGE (-2)
+
+namespace {
+    unsigned int readBE16(std::string_view bytes, unsigned long long offset) {
+        return (unsigned char) bytes[offset] << 8 | (unsigned char) bytes[offset + 1];
+    }
+
+    unsigned int readBE32(std::string_view bytes, unsigned long long offset) {
+        return (unsigned int) readBE16(bytes, offset) << 16 | readBE16(bytes, offset + 2);
+    }
+
+    // Reads a SQLite varint, and returns its length in bytes, 0 if it doesn't fit in bytes
+    unsigned int readVarint(std::string_view bytes, unsigned long long offset, unsigned long long &result) {
+        result = 0;
+        for (unsigned int i = 0; i < 9; i++) {
+            if (offset + i >= bytes.length()) return 0;
+            auto byte = (unsigned char) bytes[offset + i];
+            if (i == 8) {
+                result = (result << 8) | byte;
+                return 9;
+            }
+            result = (result << 7) | (byte & 0x7F);
+            if (!(byte & 0x80)) return i + 1;
+        }
+        return 0;
+    }
+
+    // Gets the length of a value in a record from its serial type, returns false for the reserved types
+    bool serialTypeSize(unsigned long long serialType, unsigned long long &size) {
+        static const unsigned int sizes[] = {0, 1, 2, 3, 4, 6, 8, 8, 0, 0};
+        if (serialType < 10) {
+            size = sizes[serialType];
+            return true;
+        }
+        if (serialType < 12) return false;
+        size = (serialType - 12) / 2;
+        return true;
+    }
+
+    std::string toUpper(std::string_view text) {
+        std::string result(text);
+        for (char &c : result) {
+            if (c >= 'a' && c <= 'z') c = static_cast<char>(c - 'a' + 'A');
+        }
+        return result;
+    }
+
+    bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+        return a.length() == b.length() && toUpper(a) == toUpper(b);
+    }
+
+    std::string_view trim(std::string_view text) {
+        while (!text.empty() && std::isspace((unsigned char) text.front())) text.remove_prefix(1);
+        while (!text.empty() && std::isspace((unsigned char) text.back())) text.remove_suffix(1);
+        return text;
+    }
+
+    // Reads an identifier at the start of text, which may be quoted, and returns the rest of text after it
+    std::string_view readIdentifier(std::string_view text, std::string &name, bool &quoted) {
+        name.clear();
+        quoted = !text.empty() && (text[0] == '"' || text[0] == '`' || text[0] == '[' || text[0] == '\'');
+        if (!quoted) {
+            std::size_t end = 0;
+            while (end < text.length() && !std::isspace((unsigned char) text[end]) && text[end] != '(' && text[end] != ',') end++;
+            name = text.substr(0, end);
+            return text.substr(end);
+        }
+        char close = (text[0] == '[') ? ']' : text[0];
+        std::size_t i = 1;
+        for (; i < text.length(); i++) {
+            if (text[i] != close) {
+                name += text[i];
+            } else if (close != ']' && i + 1 < text.length() && text[i + 1] == close) {
+                // Doubled quotes are an escaped quote
+                name += close;
+                i++;
+            } else {
+                break;
+            }
+        }
+        return text.substr(std::min(i + 1, text.length()));
+    }
+
+    // Splits the body of a CREATE TABLE statement into its column and constraint definitions
+    std::vector<std::string_view> splitDefinitions(std::string_view body) {
+        std::vector<std::string_view> result;
+        int depth = 0;
+        char quote = 0;
+        std::size_t start = 0;
+        for (std::size_t i = 0; i < body.length(); i++) {
+            char c = body[i];
+            if (quote) {
+                if (c == quote) quote = 0;
+            } else if (c == '\'' || c == '"' || c == '`') {
+                quote = c;
+            } else if (c == '[') {
+                quote = ']';
+            } else if (c == '(') {
+                depth++;
+            } else if (c == ')') {
+                depth--;
+            } else if (c == ',' && depth == 0) {
+                result.push_back(trim(body.substr(start, i - start)));
+                start = i + 1;
+            }
+        }
+        result.push_back(trim(body.substr(start)));
+        return result;
+    }
+
+    // Gets a column's affinity from its declared type, following https://www.sqlite.org/datatype3.html#determination_of_column_affinity
+    DBAffinity getAffinity(const std::string &upperType) {
+        if (upperType.find("INT") != std::string::npos) return NumericAffinity;
+        if (upperType.find("CHAR") != std::string::npos || upperType.find("CLOB") != std::string::npos || upperType.find("TEXT") != std::string::npos) return TextAffinity;
+        if (upperType.empty() || upperType.find("BLOB") != std::string::npos) return BlobAffinity;
+        return NumericAffinity;
+    }
+
+    // Reads the columns of a table from its CREATE TABLE statement, and returns whether the table can be scanned
+    bool parseColumns(std::string_view sql, DBTable &table) {
+        std::size_t open = sql.find('(');
+        std::size_t close = sql.rfind(')');
+        if (open == std::string_view::npos || close == std::string_view::npos || close < open) return false;
+        // Tables without rowids are stored as indexes
+        if (toUpper(sql.substr(close + 1)).find("WITHOUT") != std::string::npos) return false;
+        static const std::vector<std::string> constraintWords = {"CONSTRAINT", "PRIMARY", "NOT", "NULL", "UNIQUE", "CHECK", "DEFAULT", "COLLATE", "REFERENCES", "GENERATED", "AS"};
+        std::vector<std::string> columnTypes;
+        std::string primaryKey;
+        table.columns.clear();
+        table.rowidColumn = -1;
+        for (std::string_view definition : splitDefinitions(sql.substr(open + 1, close - open - 1))) {
+            std::string name;
+            bool quoted;
+            std::string_view rest = readIdentifier(definition, name, quoted);
+            std::string upperName = toUpper(name);
+            if (!quoted && (upperName == "CONSTRAINT" || upperName == "UNIQUE" || upperName == "CHECK" || upperName == "FOREIGN")) continue;
+            if (!quoted && upperName == "PRIMARY") {
+                // A table constraint PRIMARY KEY(column) on a single INTEGER column also makes it the rowid
+                std::size_t keyOpen = rest.find('(');
+                std::size_t keyClose = rest.rfind(')');
+                if (keyOpen != std::string_view::npos && keyClose != std::string_view::npos && keyClose > keyOpen) {
+                    std::string_view key = trim(rest.substr(keyOpen + 1, keyClose - keyOpen - 1));
+                    if (key.find(',') == std::string_view::npos) readIdentifier(key, primaryKey, quoted);
+                }
+                continue;
+            }
+            if (name.empty()) return false;
+            std::string upperRest = toUpper(rest);
+            // Generated columns aren't stored in records, so the other columns wouldn't be where the schema says
+            if (upperRest.find("GENERATED") != std::string::npos || upperRest.find(" AS ") != std::string::npos || upperRest.find(" AS(") != std::string::npos) return false;
+            // The declared type is every word before the first constraint
+            std::string type;
+            std::size_t pos = 0;
+            while (pos < upperRest.length()) {
+                while (pos < upperRest.length() && std::isspace((unsigned char) upperRest[pos])) pos++;
+                std::size_t end = pos;
+                while (end < upperRest.length() && !std::isspace((unsigned char) upperRest[end])) end++;
+                std::string word = upperRest.substr(pos, end - pos);
+                if (word.empty() || std::find(constraintWords.begin(), constraintWords.end(), word) != constraintWords.end()) break;
+                if (!type.empty()) type += " ";
+                type += word;
+                pos = end;
+            }
+            bool collated = upperRest.find("COLLATE") != std::string::npos && upperRest.find("COLLATE BINARY") == std::string::npos;
+            if (type == "INTEGER" && upperRest.find("PRIMARY KEY") != std::string::npos && upperRest.find("PRIMARY KEY DESC") == std::string::npos) {
+                table.rowidColumn = static_cast<int>(table.columns.size());
+            }
+            table.columns.push_back({name, getAffinity(type), !collated});
+            columnTypes.push_back(type);
+        }
+        if (!primaryKey.empty()) {
+            int index = table.columnIndex(primaryKey);
+            if (index >= 0 && columnTypes[index] == "INTEGER") table.rowidColumn = index;
+        }
+        return !table.columns.empty();
+    }
+}
+
+int DBTable::columnIndex(std::string_view name) const {
+    for (int i = 0; i < columns.size(); i++) {
+        if (equalsIgnoreCase(columns[i].name, name)) return i;
+    }
+    return -1;
+}
+
+bool DBRow::column(int index, DBValue &value) const {
+    value = DBValue();
+    if (index == rowidColumn) {
+        value.type = DBValue::Integer;
+        value.integer = rowid;
+        return true;
+    }
+    unsigned long long headerSize, serialType, size;
+    unsigned int length = readVarint(payload, 0, headerSize);
+    if (length == 0 || headerSize > payload.length()) return false;
+    unsigned long long pos = length, offset = headerSize;
+    for (int i = 0; pos < headerSize; i++) {
+        length = readVarint(payload.substr(0, headerSize), pos, serialType);
+        if (length == 0 || !serialTypeSize(serialType, size)) return false;
+        pos += length;
+        if (i < index) {
+            offset += size;
+            continue;
+        }
+        if (size > payload.length() || offset > payload.length() - size) return false;
+        if (serialType >= 1 && serialType <= 6) {
+            // Big-endian two's complement
+            unsigned long long bits = 0;
+            for (unsigned long long b = 0; b < size; b++) bits = (bits << 8) | (unsigned char) payload[offset + b];
+            unsigned int shift = 64 - 8 * size;
+            value.type = DBValue::Integer;
+            value.integer = static_cast<long long>(bits << shift) >> shift;
+        } else if (serialType == 7) {
+            unsigned long long bits = 0;
+            for (unsigned long long b = 0; b < 8; b++) bits = (bits << 8) | (unsigned char) payload[offset + b];
+            value.type = DBValue::Real;
+            value.real = std::bit_cast<double>(bits);
+        } else if (serialType == 8 || serialType == 9) {
+            value.type = DBValue::Integer;
+            value.integer = static_cast<long long>(serialType - 8);
+        } else if (serialType >= 12) {
+            value.type = (serialType % 2) ? DBValue::Text : DBValue::Blob;
+            value.bytes = payload.substr(offset, size);
+        }
+        return true;
+    }
+    // The row was written before the column was added
+    return true;
+}
+
+DBReader::DBReader(std::string_view image) : image(image) {
+    if (image.length() < DB_HEADER_SIZE || std::memcmp(image.data(), SQLITE_HEADER, sizeof(SQLITE_HEADER)) != 0) return;
+    unsigned long long size = readBE16(image, 16);
+    if (size == 1) size = 65536;
+    if (size < 512 || !std::has_single_bit(size)) return;
+    auto reserved = (unsigned char) image[20];
+    unsigned int encoding = readBE32(image, 56);
+    // Text in other encodings would have to be converted
+    if (encoding > 1 || size - reserved < 480) return;
+    pageSize = size;
+    usableSize = size - reserved;
+    pageCount = image.length() / pageSize;
+}
+
+bool DBReader::valid() const {
+    return pageSize != 0;
+}
+
+bool DBReader::findTable(std::string_view name, DBTable &table) {
+    if (!valid()) return false;
+    // sqlite_schema's columns are type, name, tbl_name, rootpage, sql
+    DBTable schema = {"sqlite_schema", 1, {}, -1};
+    std::string sql;
+    bool found = false;
+    scan(schema, [&](const DBRow &row) {
+        DBValue type, tableName, rootPage, statement;
+        if (found || !row.column(0, type) || type.bytes != "table" || !row.column(1, tableName) || !equalsIgnoreCase(tableName.bytes, name)) return;
+        if (!row.column(3, rootPage) || rootPage.type != DBValue::Integer || !row.column(4, statement) || statement.type != DBValue::Text) return;
+        found = true;
+        table.name = tableName.bytes;
+        table.rootPage = static_cast<unsigned int>(rootPage.integer);
+        sql = statement.bytes;
+    });
+    // A table can still be found if other parts of the schema can't be read
+    return found && table.rootPage > 0 && parseColumns(sql, table);
+}
+
+bool DBReader::scan(const DBTable &table, const std::function<void(const DBRow &)> &onRow) {
+    if (!valid()) return false;
+    pagesLeft = pageCount;
+    return scanPage(table.rootPage, table.rowidColumn, 0, onRow);
+}
+
+// Reads every row in the tree starting at page, and returns whether all of it could be read
+bool DBReader::scanPage(unsigned long long page, int rowidColumn, int depth, const std::function<void(const DBRow &)> &onRow) {
+    if (depth > DB_MAX_TREE_DEPTH || page == 0 || page > pageCount || pagesLeft == 0) return false;
+    pagesLeft--;
+    std::string_view data = image.substr((page - 1) * pageSize, usableSize);
+    unsigned long long header = (page == 1) ? DB_HEADER_SIZE : 0;
+    if (header + 8 > data.length()) return false;
+    auto type = (unsigned char) data[header];
+    unsigned int cellCount = readBE16(data, header + 3);
+    unsigned long long pointers = header + ((type == DB_INTERIOR_TABLE_PAGE) ? 12 : 8);
+    if (type != DB_LEAF_TABLE_PAGE && type != DB_INTERIOR_TABLE_PAGE) return false;
+    if (pointers + 2ULL * cellCount > data.length()) return false;
+    bool complete = true;
+    for (unsigned int i = 0; i < cellCount; i++) {
+        unsigned long long cell = readBE16(data, pointers + 2ULL * i);
+        if (type == DB_INTERIOR_TABLE_PAGE) {
+            // Left child pointer, then the largest rowid in it
+            if (cell + 4 > data.length()) return false;
+            complete = scanPage(readBE32(data, cell), rowidColumn, depth + 1, onRow) && complete;
+            continue;
+        }
+        long long rowid;
+        std::string_view payload;
+        if (!readLeafCell(data, cell, rowid, payload)) return false;
+        onRow(DBRow(payload, rowid, rowidColumn));
+    }
+    if (type == DB_INTERIOR_TABLE_PAGE) complete = scanPage(readBE32(data, header + 8), rowidColumn, depth + 1, onRow) && complete;
+    return complete;
+}
+
+// Gets a cell's payload, putting it back together if it continues onto overflow pages. Returns whether it could be read
+bool DBReader::readPayload(std::string_view page, unsigned long long cell, unsigned long long payloadSize, std::string_view &payload) {
+    // How much of the payload is stored in the page itself, see https://www.sqlite.org/fileformat2.html#b_tree_pages
+    unsigned long long maxLocal = usableSize - 35;
+    unsigned long long minLocal = ((usableSize - 12) * 32 / 255) - 23;
+    unsigned long long local = payloadSize;
+    if (payloadSize > maxLocal) {
+        local = minLocal + (payloadSize - minLocal) % (usableSize - 4);
+        if (local > maxLocal) local = minLocal;
+    }
+    if (cell > page.length() || local > page.length() - cell) return false;
+    if (local == payloadSize) {
+        payload = page.substr(cell, payloadSize);
+        return true;
+    }
+    if (cell + local + 4 > page.length()) return false;
+    overflow.assign(page.substr(cell, local));
+    unsigned long long next = readBE32(page, cell + local);
+    while (overflow.length() < payloadSize) {
+        if (next == 0 || next > pageCount || pagesLeft == 0) return false;
+        pagesLeft--;
+        std::string_view data = image.substr((next - 1) * pageSize, usableSize);
+        next = readBE32(data, 0);
+        overflow.append(data.substr(4, std::min(usableSize - 4, payloadSize - overflow.length())));
+    }
+    payload = overflow;
+    return true;
+}
+
+// Reads the rowid and payload of a cell on a leaf table page, and returns whether it could be read
+bool DBReader::readLeafCell(std::string_view page, unsigned long long cell, long long &rowid, std::string_view &payload) {
+    unsigned long long payloadSize, key;
+    unsigned int length = readVarint(page, cell, payloadSize);
+    if (length == 0) return false;
+    cell += length;
+    length = readVarint(page, cell, key);
+    if (length == 0) return false;
+    rowid = static_cast<long long>(key);
+    return readPayload(page, cell + length, payloadSize, payload);
+}
+
+// Gets the usable part of a page and the offset of its b-tree header, which comes after the database header on page 1
+std::string_view DBReader::pageData(unsigned long long page, unsigned long long &header) const {
+    header = (page == 1) ? DB_HEADER_SIZE : 0;
+    return image.substr((page - 1) * pageSize, usableSize);
+}
+
+// Marks every readable page in the tree starting at page as owned by owner, and adds its leaf pages to leaves
+// Returns how many pages of the tree couldn't be read
+unsigned long long DBReader::markTree(unsigned long long page, int owner, int depth, std::vector<int> &owners, std::vector<unsigned long long> &leaves) {
+    // Pages that already belong to a tree are either shared by a corrupt tree or a loop
+    if (depth > DB_MAX_TREE_DEPTH || page == 0 || page > pageCount || owners[page] != DB_UNOWNED_PAGE) return 1;
+    unsigned long long header;
+    std::string_view data = pageData(page, header);
+    if (header + 8 > data.length()) return 1;
+    auto type = (unsigned char) data[header];
+    unsigned int cellCount = readBE16(data, header + 3);
+    unsigned long long pointers = header + ((type == DB_INTERIOR_TABLE_PAGE) ? 12 : 8);
+    if (type != DB_LEAF_TABLE_PAGE && type != DB_INTERIOR_TABLE_PAGE) return 1;
+    if (pointers + 2ULL * cellCount > data.length()) return 1;
+    owners[page] = owner;
+    if (type == DB_LEAF_TABLE_PAGE) {
+        leaves.push_back(page);
+        return 0;
+    }
+    unsigned long long damaged = 0;
+    for (unsigned int i = 0; i < cellCount; i++) {
+        unsigned long long cell = readBE16(data, pointers + 2ULL * i);
+        damaged += (cell + 4 > data.length()) ? 1 : markTree(readBE32(data, cell), owner, depth + 1, owners, leaves);
+    }
+    return damaged + markTree(readBE32(data, header + 8), owner, depth + 1, owners, leaves);
+}
+
+std::vector<DBCoverage> DBReader::salvage(const std::vector<DBTable> &tables, const std::function<void(int, const DBRow &)> &onRow) {
+    std::vector<DBCoverage> coverage(tables.size());
+    if (!valid()) return coverage;
+    std::vector<int> owners(pageCount + 1, DB_UNOWNED_PAGE);
+    std::vector<std::vector<unsigned long long>> leaves(tables.size());
+    std::vector<unsigned long long> schemaLeaves;
+    markTree(1, DB_OTHER_PAGE, 0, owners, schemaLeaves);
+    for (int i = 0; i < tables.size(); i++) coverage[i].damagedPages = markTree(tables[i].rootPage, i, 0, owners, leaves[i]);
+    // Pages of every other tree in the schema, and freed pages whose rows were deleted, mustn't be mistaken for orphans
+    // Column counts of other damaged tables are kept, so orphans are only claimed when they can't be theirs
+    std::vector<unsigned long long> otherDamagedColumns;
+    for (unsigned long long page : schemaLeaves) {
+        unsigned long long header;
+        std::string_view data = pageData(page, header);
+        unsigned int cellCount = readBE16(data, header + 3);
+        for (unsigned int i = 0; i < cellCount; i++) {
+            long long rowid;
+            std::string_view payload;
+            pagesLeft = pageCount;
+            if (!readLeafCell(data, readBE16(data, header + 8 + 2ULL * i), rowid, payload)) continue;
+            DBRow row(payload, rowid, -1);
+            DBValue rootPage, statement;
+            if (!row.column(3, rootPage) || rootPage.type != DBValue::Integer || rootPage.integer <= 0) continue;
+            bool requested = std::any_of(tables.begin(), tables.end(), [&](const DBTable &table) { return table.rootPage == rootPage.integer; });
+            if (requested) continue;
+            std::vector<unsigned long long> ignored;
+            bool damaged = markTree(static_cast<unsigned long long>(rootPage.integer), DB_OTHER_PAGE, 0, owners, ignored) > 0;
+            DBTable other;
+            if (damaged && row.column(4, statement) && statement.type == DBValue::Text && parseColumns(statement.bytes, other)) {
+                otherDamagedColumns.push_back(other.columns.size());
+            }
+        }
+    }
+    unsigned long long trunk = readBE32(image, 32);
+    for (unsigned long long visited = 0; trunk != 0 && trunk <= pageCount && visited < pageCount; visited++) {
+        std::string_view data = image.substr((trunk - 1) * pageSize, usableSize);
+        owners[trunk] = DB_OTHER_PAGE;
+        unsigned long long count = std::min<unsigned long long>(readBE32(data, 4), (usableSize - 8) / 4);
+        for (unsigned long long i = 0; i < count; i++) {
+            unsigned long long leaf = readBE32(data, 8 + 4 * i);
+            if (leaf != 0 && leaf <= pageCount) owners[leaf] = DB_OTHER_PAGE;
+        }
+        trunk = readBE32(data, 0);
+    }
+    // Claim orphaned leaf pages by their records' column count, when exactly one damaged table could own them
+    for (unsigned long long page = 2; page <= pageCount; page++) {
+        unsigned long long header;
+        std::string_view data = pageData(page, header);
+        if (owners[page] != DB_UNOWNED_PAGE || (unsigned char) data[0] != DB_LEAF_TABLE_PAGE) continue;
+        unsigned int cellCount = readBE16(data, 3);
+        if (cellCount == 0 || 8 + 2ULL * cellCount > data.length()) continue;
+        long long rowid;
+        std::string_view payload;
+        pagesLeft = pageCount;
+        if (!readLeafCell(data, readBE16(data, 8), rowid, payload)) continue;
+        unsigned long long headerSize, serialType, columnCount = 0;
+        unsigned int length = readVarint(payload, 0, headerSize);
+        if (length == 0 || headerSize > payload.length()) continue;
+        for (unsigned long long pos = length; pos < headerSize; pos += length, columnCount++) {
+            length = readVarint(payload.substr(0, headerSize), pos, serialType);
+            if (length == 0) break;
+        }
+        if (std::find(otherDamagedColumns.begin(), otherDamagedColumns.end(), columnCount) != otherDamagedColumns.end()) continue;
+        int owner = DB_UNOWNED_PAGE;
+        for (int i = 0; i < tables.size(); i++) {
+            if (coverage[i].damagedPages == 0 || tables[i].columns.size() != columnCount) continue;
+            owner = (owner == DB_UNOWNED_PAGE) ? i : DB_OTHER_PAGE;
+        }
+        if (owner < 0) continue;
+        owners[page] = owner;
+        leaves[owner].push_back(page);
+        coverage[owner].orphanPages++;
+    }
+    // Read every row that's still intact
+    for (int i = 0; i < tables.size(); i++) {
+        for (unsigned long long page : leaves[i]) {
+            unsigned long long header;
+            std::string_view data = pageData(page, header);
+            unsigned int cellCount = readBE16(data, header + 3);
+            coverage[i].pages++;
+            for (unsigned int cell = 0; cell < cellCount; cell++) {
+                long long rowid;
+                std::string_view payload;
+                pagesLeft = pageCount;
+                if (!readLeafCell(data, readBE16(data, header + 8 + 2ULL * cell), rowid, payload)) {
+                    coverage[i].damagedCells++;
+                    continue;
+                }
+                coverage[i].rows++;
+                onRow(i, DBRow(payload, rowid, tables[i].rowidColumn));
+            }
+        }
+    }
+    return coverage;
+}
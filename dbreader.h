@@ -0,0 +1,110 @@
+#ifndef LEGILIMENS_HOGWARTS_LEGACY_CPP_DBREADER_H
+#define LEGILIMENS_HOGWARTS_LEGACY_CPP_DBREADER_H
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define DB_HEADER_SIZE 100
+#define DB_MAX_TREE_DEPTH 64
+
+// Reads tables straight out of the bytes of a SQLite database file (https://www.sqlite.org/fileformat2.html),
+// without going through SQLite. Only supports what Legilimens needs: scanning every row of rowid tables in UTF-8 databases
+
+// A value in a row. Text and blobs point into the database or the reader's overflow buffer, so they're only valid during the scan callback
+struct DBValue {
+    enum Type {
+        Null,
+        Integer,
+        Real,
+        Text,
+        Blob
+    };
+    Type type = Null;
+    long long integer = 0;
+    double real = 0;
+    std::string_view bytes;
+};
+
+// How SQLite converts values stored in, or compared with, a column
+enum DBAffinity {
+    TextAffinity,
+    NumericAffinity, // Also INTEGER and REAL affinity, which compare the same way
+    BlobAffinity
+};
+
+// A column of a table, from its CREATE TABLE statement
+struct DBColumn {
+    std::string name;
+    DBAffinity affinity;
+    bool binaryCollation; // Whether text is compared byte by byte, i.e. there's no COLLATE clause
+};
+
+// A table's root page and columns
+struct DBTable {
+    std::string name;
+    unsigned int rootPage = 0;
+    std::vector<DBColumn> columns;
+    int rowidColumn = -1; // Column that is an alias of the rowid (INTEGER PRIMARY KEY), -1 if none
+
+    // Gets the index of a column, case insensitive like SQL. -1 if there is no such column
+    int columnIndex(std::string_view name) const;
+};
+
+// A row of a table, decoded on demand
+class DBRow {
+public:
+    DBRow(std::string_view payload, long long rowid, int rowidColumn) : payload(payload), rowid(rowid), rowidColumn(rowidColumn) {}
+
+    // Reads a column, and returns whether the record could be decoded. Columns added after the row was written are NULL
+    bool column(int index, DBValue &value) const;
+
+private:
+    std::string_view payload;
+    long long rowid;
+    int rowidColumn;
+};
+
+// How much of a table a salvage scan recovered
+struct DBCoverage {
+    unsigned long long rows = 0;
+    unsigned long long pages = 0;         // Leaf pages rows were recovered from
+    unsigned long long orphanPages = 0;   // Of those, pages that could only be found by looking at every page, because the tree leading to them is damaged
+    unsigned long long damagedPages = 0;  // Pages in the table's tree that couldn't be read
+    unsigned long long damagedCells = 0;  // Rows on readable pages that couldn't be read
+
+    bool complete() const { return damagedPages == 0 && damagedCells == 0 && orphanPages == 0; }
+};
+
+class DBReader {
+public:
+    explicit DBReader(std::string_view image);
+
+    // Whether the image starts with a database header this reader supports
+    bool valid() const;
+    // Looks a table up in the schema, and returns whether it was found and can be scanned
+    bool findTable(std::string_view name, DBTable &table);
+    // Calls onRow for every row of the table, and returns whether every page of it could be read
+    bool scan(const DBTable &table, const std::function<void(const DBRow &)> &onRow);
+    // Recovers every intact row of the tables it can find, even if parts of the database are corrupt, and returns how much of each table it read
+    // Each tree is read as far as it can be, then leaf pages that no tree leads to are claimed by the only damaged table whose rows look like theirs
+    // onRow gets the index of the row's table in tables
+    std::vector<DBCoverage> salvage(const std::vector<DBTable> &tables, const std::function<void(int, const DBRow &)> &onRow);
+
+private:
+    std::string_view image;
+    unsigned long long pageSize = 0;
+    unsigned long long usableSize = 0;
+    unsigned long long pageCount = 0;
+    unsigned long long pagesLeft = 0; // Pages the current scan may still visit, so a corrupt tree can't loop forever
+    std::string overflow; // Payloads that continue onto overflow pages are put back together here
+
+    bool scanPage(unsigned long long page, int rowidColumn, int depth, const std::function<void(const DBRow &)> &onRow);
+    bool readPayload(std::string_view page, unsigned long long cell, unsigned long long payloadSize, std::string_view &payload);
+    bool readLeafCell(std::string_view page, unsigned long long cell, long long &rowid, std::string_view &payload);
+    std::string_view pageData(unsigned long long page, unsigned long long &header) const;
+    unsigned long long markTree(unsigned long long page, int owner, int depth, std::vector<int> &owners, std::vector<unsigned long long> &leaves);
+};
+
+#endif //LEGILIMENS_HOGWARTS_LEGACY_CPP_DBREADER_H
@@ -7,29 +7,61 @@
 #include <map>
 #include <chrono>
 #include "tabulate.hpp"
+#include "savefile.h"
+#include "gvas.h"
+#include "workers.h"
 
+#define CHAR_NAME_PROPERTY "CharacterName"
+#define CHAR_HOUSE_PROPERTY "CharacterHouse"
 #define CHAR_NAME_STR "CharacterName\x00"
 #define CHAR_HOUSE_STR "CharacterHouse\x00"
 #define CHAR_NAME_OFFSET 43
 #define CHAR_HOUSE_OFFSET 44
+#define SAVE_INFO_PREFIX_SIZE (64 * 1024)
+#define SAVE_SCAN_WORKERS 8
 
-unsigned int readU32(const std::string &bytes, unsigned long long index) {
+unsigned int readU32(std::string_view bytes, unsigned long long index) {
     return (unsigned char)(bytes[index+3]) << 24 | (unsigned char)(bytes[index+2]) << 16 | (unsigned char)(bytes[index+1]) << 8 | (unsigned char)(bytes[index]);
 }
 
-// Gets the character name and house from a save file, returns whether it's a valid save file
-bool readSaveInfo(const std::filesystem::path& savePath, std::string &charName, std::string &charHouse) {
+// Gets the character name and house (and where the database is, if it's found along the way) from a save file,
+// returns whether it's a valid save file
+bool readSaveInfo(const std::filesystem::path& savePath, SaveInfo &info) {
+    // Only the fields found in this save are set below, so none can be left over from another one
+    info = SaveInfo();
+    std::string &charName = info.charName;
+    std::string &charHouse = info.charHouse;
+    info.saveType = getSaveType(savePath);
     // Try to open the file
     if (!std::filesystem::exists(savePath)) return false;
-    std::ifstream fs(savePath, std::ios::in|std::ios::binary);
-    if (!fs.is_open()) return false;
-    // Read the file
-    std::ostringstream sstr;
-    sstr << fs.rdbuf();
-    std::string saveData = sstr.str();
-    fs.close();
-    // Check magic header
-    if (!saveData.starts_with(MAGIC_HEADER)) return false;
+    // The character's properties are near the start of the save, so only read as much of it as it takes to find them
+    SaveFile save;
+    std::string_view saveData;
+    for (std::size_t prefixSize = SAVE_INFO_PREFIX_SIZE; ; prefixSize *= 4) {
+        if (!save.open(savePath, prefixSize)) return false;
+        saveData = save.data();
+        // Check magic header
+        if (!saveData.starts_with(MAGIC_HEADER)) return false;
+        // Find character name and house through the save's properties
+        GvasIndex index;
+        if (!indexGvas(saveData, index, {CHAR_NAME_PROPERTY, CHAR_HOUSE_PROPERTY, DB_IMAGE_STR})) break;
+        getGvasString(saveData, index, CHAR_NAME_PROPERTY, charName);
+        getGvasString(saveData, index, CHAR_HOUSE_PROPERTY, charHouse);
+        // The database's location is known from its header even if its content is past the end of the prefix
+        auto dbProperty = index.find(DB_IMAGE_STR);
+        if (dbProperty != index.end() && dbProperty->second.innerType == "ByteProperty" && dbProperty->second.size >= 4 &&
+            dbProperty->second.offset + 4 <= saveData.length()) {
+            info.dbOffset = dbProperty->second.offset + 4;
+            info.dbSize = std::min<unsigned long long>(readU32(saveData, dbProperty->second.offset), dbProperty->second.size - 4);
+        }
+        if (!charName.empty() && !charHouse.empty()) return true;
+        if (save.size() >= save.fileSize()) break;
+    }
+    // Fall back to searching the whole file for the character name and house if the properties couldn't be read
+    if (save.size() < save.fileSize()) {
+        if (!save.open(savePath)) return false;
+        saveData = save.data();
+    }
     // Find character name
     std::size_t found = saveData.find(CHAR_NAME_STR);
     unsigned int strLength;
@@ -50,23 +82,22 @@ bool readSaveInfo(const std::filesystem::path& savePath, std::string &charName,
     return true;
 }
 
+// Returns whether the file name has the format "HL-xx-xx.sav"
+bool isSaveName(const std::filesystem::path& savePath) {
+    if (savePath.extension().string() != ".sav") return false;
+    if (savePath.filename().string().length() != 12) return false;
+    return savePath.filename().string().starts_with("HL-");
+}
+
 // Returns whether file is a valid save
 bool isValid(const std::filesystem::path& savePath) {
     // Make sure format is "HL-xx-xx.sav" and that file existss
-    if (savePath.extension().string() != ".sav") return false;
-    if (savePath.filename().string().length() != 12) return false;
-    if (!savePath.filename().string().starts_with("HL-")) return false;
+    if (!isSaveName(savePath)) return false;
     if (!std::filesystem::exists(savePath)) return false;
     // Check for magic header b"GVAS"
-    std::ifstream fs(savePath, std::ios::in|std::ios::binary);
-    if (!fs.is_open()) return false;
-    std::string header;
-    char* buffer = new char[5];
-    for (int i = 0; i < 5; i++) buffer[i] = '\x00';
-    fs.read(buffer, 4);
-    fs.close();
-    header = buffer;
-    return (header == MAGIC_HEADER);
+    SaveFile save;
+    if (!save.open(savePath, sizeof(MAGIC_HEADER) - 1)) return false;
+    return (save.data() == MAGIC_HEADER);
 }
 
 struct SaveList {
@@ -80,8 +111,19 @@ bool pairCompare(const std::pair<std::filesystem::path, std::filesystem::file_ti
     return (a.second == b.second) ? (a.first < b.first) : (a.second > b.second);
 }
 
+// A save found while scanning the users folder
+struct ScannedSave {
+    std::filesystem::path path;
+    std::string userFolder;
+    std::uintmax_t size;
+    std::filesystem::file_time_type time;
+    SaveInfo info;
+    bool valid;
+};
+
 // Gets lists of potential save files, where each list corresponds to a single character
-std::vector<SaveList> getSaveList() {
+// Saves that haven't changed since they were last listed are read from the cache, and the rest are read in parallel
+std::vector<SaveList> getSaveList(SaveCache &cache) {
     std::vector<SaveList> result;
     // Find %LocalAppData%
     std::filesystem::path localAppData, users;
@@ -97,25 +139,50 @@ std::vector<SaveList> getSaveList() {
     users = localAppData / "HogwartsLegacy" / "Saved" / "SaveGames";
     if (!std::filesystem::is_directory(users)) users = localAppData / "Hogwarts Legacy" / "Saved" / "SaveGames";
     if (!std::filesystem::is_directory(users)) return result;
-    // Find each user
-    std::string charIndex;
+    // Find every save of each user, getting unchanged saves from the cache
+    std::vector<std::string> userFolders;
+    std::vector<ScannedSave> scanned;
+    std::vector<std::size_t> toRead;
+    std::error_code ec;
     for (auto const& userFolder : std::filesystem::directory_iterator{users}) {
         if (!std::filesystem::is_directory(userFolder)) continue;
-        std::unordered_map<std::string, std::vector<std::filesystem::path>> savesByChar;
-        // Get saves for each user,
+        userFolders.push_back(userFolder.path().string());
         for (auto const& saveFile : std::filesystem::directory_iterator{userFolder}) {
-            if (!isValid(saveFile.path())) continue;
-            charIndex = saveFile.path().filename().string().substr(3, 2);  // "HL-01-11.sav" -> "01"
-            savesByChar[charIndex].push_back(saveFile.path());
+            if (!isSaveName(saveFile.path())) continue;
+            ScannedSave save = {saveFile.path(), userFolders.back(), saveFile.file_size(ec), {}, {}, false};
+            if (ec) continue;
+            save.time = saveFile.last_write_time(ec);
+            if (ec) continue;
+            save.valid = cache.find(save.path, save.size, save.time, save.info);
+            if (!save.valid) toRead.push_back(scanned.size());
+            scanned.push_back(save);
+        }
+    }
+    // Read the rest in parallel, since it's mostly waiting on the disk
+    runParallel(toRead.size(), SAVE_SCAN_WORKERS, [&](std::size_t i) {
+        ScannedSave &save = scanned[toRead[i]];
+        save.valid = isValid(save.path) && readSaveInfo(save.path, save.info);
+    });
+    for (std::size_t i : toRead) {
+        if (scanned[i].valid) cache.insert(scanned[i].path, scanned[i].size, scanned[i].time, scanned[i].info);
+    }
+    // Group each user's saves by character, in the order they were found
+    std::string charIndex;
+    auto nextSave = scanned.begin();
+    for (const auto &userFolder : userFolders) {
+        std::unordered_map<std::string, std::vector<ScannedSave *>> savesByChar;
+        for (; nextSave != scanned.end() && nextSave->userFolder == userFolder; nextSave++) {
+            if (!nextSave->valid) continue;
+            charIndex = nextSave->path.filename().string().substr(3, 2);  // "HL-01-11.sav" -> "01"
+            savesByChar[charIndex].push_back(&*nextSave);
         }
         // Add to save list
         for ( auto &p : savesByChar ) {
             SaveList saves = {{}, "", ""};
-            for ( const auto &savePath : p.second ) {
-                if (saves.charName.empty() || saves.charHouse.empty()) {
-                    readSaveInfo(savePath, saves.charName, saves.charHouse);
-                }
-                saves.paths.emplace_back(savePath, std::filesystem::last_write_time(savePath));
+            for ( const auto *save : p.second ) {
+                if (saves.charName.empty()) saves.charName = save->info.charName;
+                if (saves.charHouse.empty()) saves.charHouse = save->info.charHouse;
+                saves.paths.emplace_back(save->path, save->time);
             }
             sort(saves.paths.begin(), saves.paths.end(), pairCompare);
             if (saves.charName.empty()) saves.charName = "Unknown name";
@@ -123,6 +190,7 @@ std::vector<SaveList> getSaveList() {
             if (!saves.paths.empty()) result.push_back(saves);
         }
     }
+    cache.write();
     return result;
 }
 
@@ -187,8 +255,8 @@ bool getSavePathForChar(SaveList saves, std::filesystem::path &result) {
     return false;
 }
 
-// Prompts the user to select a character, then a save for that character. Returns true on success, false on back
-bool getCharacter(std::vector<SaveList> &saves, std::filesystem::path &result) {
+// Gets the table of characters to choose from, followed by "Go back"
+tabulate::Table getCharacterTable(const std::vector<SaveList> &saves) {
     tabulate::Table table;
     table.add_row({"Choice", "Name", "House"});
     for (int i = 0; i < saves.size(); i++) {
@@ -210,6 +278,12 @@ bool getCharacter(std::vector<SaveList> &saves, std::filesystem::path &result) {
     table.column(1).format().width(TABLE_WIDTH - CHOICE_COL_WIDTH - 15 - 2);
     table.column(2).format().width(15).font_align(tabulate::FontAlign::center);
     for (int i = 1; i < table.size(); i++) table[i][0].format().font_color(tabulate::Color::cyan);
+    return table;
+}
+
+// Prompts the user to select a character, then a save for that character. Returns true on success, false on back
+bool getCharacter(std::vector<SaveList> &saves, std::filesystem::path &result) {
+    tabulate::Table table = getCharacterTable(saves);
     unsigned int choice;
     while (true) {
         std::cout << std::endl << table << std::endl;
@@ -232,7 +306,7 @@ std::filesystem::path manuallyInputPath() {
 }
 
 // Prompts user for manual input or auto save detection
-std::filesystem::path getSavePath() {
+std::filesystem::path getSavePath(SaveCache &cache) {
     tabulate::Table table;
     table.add_row({"Choice", "Option"});
     table.add_row({"0", "Automatically detect saves"});
@@ -249,7 +323,7 @@ std::filesystem::path getSavePath() {
         choice = getChoice(1, "How would you like to find your save path?");
         if (choice == 1) return manuallyInputPath();
         if (!scanned) {
-            saves = getSaveList();
+            saves = getSaveList(cache);
             scanned = true;
         }
         if (saves.empty()) {
@@ -259,3 +333,22 @@ std::filesystem::path getSavePath() {
         if (getCharacter(saves, result)) return result;
     }
 }
+
+bool getLatestSaves(SaveCache &cache, std::filesystem::path &previous, std::filesystem::path &latest) {
+    std::vector<SaveList> saves = getSaveList(cache);
+    std::erase_if(saves, [](const SaveList &characterSaves) { return characterSaves.paths.size() < 2; });
+    if (saves.empty()) {
+        std::cout << "Legilimens was unable to detect a character with more than one save." << std::endl;
+        return false;
+    }
+    unsigned int choice = 0;
+    if (saves.size() > 1) {
+        std::cout << std::endl << getCharacterTable(saves) << std::endl;
+        choice = getChoice(saves.size(), "Which character's latest saves should Legilimens compare?");
+        if (choice >= saves.size()) return false;
+    }
+    // Each character's saves are sorted newest first
+    latest = saves[choice].paths[0].first;
+    previous = saves[choice].paths[1].first;
+    return true;
+}
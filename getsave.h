@@ -2,12 +2,21 @@
 #define LEGILIMENS_HOGWARTS_LEGACY_CPP_GETSAVE_H
 
 #include <filesystem>
+#include <string_view>
+#include "savecache.h"
 
 #define MAGIC_HEADER "GVAS"
+#define DB_IMAGE_STR "RawDatabaseImage"
+#define SQLITE_HEADER "SQLite format 3"
 #define TABLE_WIDTH 85
 #define CHOICE_COL_WIDTH 9
 
-unsigned int readU32(const std::string &bytes, unsigned long long index);
-std::filesystem::path getSavePath();
+unsigned int readU32(std::string_view bytes, unsigned long long index);
+bool readSaveInfo(const std::filesystem::path& savePath, SaveInfo &info);
+std::string getSaveType(const std::filesystem::path& savePath);
+std::filesystem::path getSavePath(SaveCache &cache);
+// Finds the two most recent saves of a character, prompting for the character if there's more than one
+// Returns false if no character has two saves, or the user went back
+bool getLatestSaves(SaveCache &cache, std::filesystem::path &previous, std::filesystem::path &latest);
 
 #endif //LEGILIMENS_HOGWARTS_LEGACY_CPP_GETSAVE_H
@@ -0,0 +1,207 @@
+#include "gvas.h"
+#include <unordered_set>
+#include "getsave.h"
+
+#define GVAS_GUID_SIZE 16
+#define GVAS_CUSTOM_VERSION_SIZE 20
+
+namespace {
+    // Structs that are serialized as raw binary instead of a list of properties
+    const std::unordered_set<std::string> nativeStructs = {
+            "Vector", "Vector2D", "Vector4", "IntVector", "IntPoint", "Rotator", "Quat", "Box", "Box2D", "Color",
+            "LinearColor", "Guid", "DateTime", "Timespan", "SoftObjectPath", "SoftClassPath", "GameplayTagContainer"
+    };
+
+    // Reads values in order out of a byte range, failing instead of reading past its end
+    struct GvasCursor {
+        std::string_view bytes;
+        unsigned long long pos;
+        unsigned long long end;
+
+        bool skip(unsigned long long count) {
+            if (count > end - pos) return false;
+            pos += count;
+            return true;
+        }
+
+        bool u8(unsigned char &result) {
+            if (pos >= end) return false;
+            result = static_cast<unsigned char>(bytes[pos++]);
+            return true;
+        }
+
+        bool u32(unsigned int &result) {
+            if (end - pos < 4) return false;
+            result = readU32(bytes, pos);
+            pos += 4;
+            return true;
+        }
+
+        bool u64(unsigned long long &result) {
+            if (end - pos < 8) return false;
+            result = readU32(bytes, pos) | (unsigned long long) readU32(bytes, pos + 4) << 32;
+            pos += 8;
+            return true;
+        }
+
+        bool fString(std::string &result) {
+            unsigned long long next;
+            if (pos >= end || !readFString(bytes.substr(0, end), pos, result, &next)) return false;
+            pos = next;
+            return true;
+        }
+
+        // Reads a property's optional GUID
+        bool propertyGuid() {
+            unsigned char hasGuid;
+            return u8(hasGuid) && (!hasGuid || skip(GVAS_GUID_SIZE));
+        }
+    };
+
+    // Property names are short identifiers, anything else means the bytes aren't a property list
+    bool isPropertyName(const std::string &name) {
+        if (name.empty() || name.length() > GVAS_MAX_NAME_LENGTH) return false;
+        for (unsigned char c : name) {
+            if (c < 0x20 || c == 0x7F) return false;
+        }
+        return true;
+    }
+
+    // Appends a code point to a UTF-8 string
+    void appendUtf8(std::string &result, unsigned int codePoint) {
+        if (codePoint < 0x80) {
+            result += static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            result += static_cast<char>(0xC0 | (codePoint >> 6));
+            result += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else if (codePoint < 0x10000) {
+            result += static_cast<char>(0xE0 | (codePoint >> 12));
+            result += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            result += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else {
+            result += static_cast<char>(0xF0 | (codePoint >> 18));
+            result += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            result += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            result += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    // Returns whether every property in stopAt has been found
+    bool foundAll(const GvasIndex &index, const std::vector<std::string> &stopAt) {
+        if (stopAt.empty()) return false;
+        for (const auto &name : stopAt) {
+            if (!index.contains(name)) return false;
+        }
+        return true;
+    }
+
+    // Reads the property list starting at the cursor up to its "None" terminator, and returns whether it was valid
+    bool indexProperties(GvasCursor &cursor, GvasIndex &index, const std::vector<std::string> &stopAt, int depth) {
+        std::string name, type, innerType, valueType;
+        unsigned long long size;
+        unsigned char boolValue;
+        while (cursor.fString(name)) {
+            if (name == "None") return true;
+            if (!isPropertyName(name) || !cursor.fString(type) || !isPropertyName(type) || !cursor.u64(size)) return false;
+            // Type specific part of the header
+            innerType.clear();
+            bool validHeader;
+            if (type == "StructProperty") {
+                validHeader = cursor.fString(innerType) && cursor.skip(GVAS_GUID_SIZE) && cursor.propertyGuid();
+            } else if (type == "ArrayProperty" || type == "SetProperty" || type == "ByteProperty" || type == "EnumProperty") {
+                validHeader = cursor.fString(innerType) && cursor.propertyGuid();
+            } else if (type == "MapProperty") {
+                validHeader = cursor.fString(innerType) && cursor.fString(valueType) && cursor.propertyGuid();
+            } else if (type == "BoolProperty") {
+                validHeader = cursor.u8(boolValue) && cursor.propertyGuid();
+            } else {
+                validHeader = cursor.propertyGuid();
+            }
+            if (!validHeader) return false;
+            if (index.try_emplace(name, GvasProperty{type, innerType, cursor.pos, size}).second && foundAll(index, stopAt)) return true;
+            // Look inside structs that are made of properties, without trusting them to be well formed
+            // This includes the start of a struct that doesn't fit in the bytes, in case they're only the start of the save
+            bool truncated = size > cursor.end - cursor.pos;
+            if (type == "StructProperty" && depth < GVAS_MAX_DEPTH && !nativeStructs.contains(innerType)) {
+                GvasCursor nested = {cursor.bytes, cursor.pos, truncated ? cursor.end : cursor.pos + size};
+                indexProperties(nested, index, stopAt, depth + 1);
+                if (foundAll(index, stopAt)) return true;
+            }
+            if (truncated) return false;
+            cursor.pos += size;
+        }
+        return false;
+    }
+}
+
+bool readFString(std::string_view bytes, unsigned long long offset, std::string &result, unsigned long long *end) {
+    if (offset + 4 > bytes.length()) return false;
+    auto length = static_cast<int>(readU32(bytes, offset));
+    offset += 4;
+    result.clear();
+    if (length == 0) {
+        if (end) *end = offset;
+        return true;
+    }
+    if (length > 0) {
+        // UTF-8, including a null terminator
+        if (length > bytes.length() - offset) return false;
+        result = bytes.substr(offset, length - 1);
+        offset += length;
+    } else {
+        // UTF-16, -length code units including a null terminator
+        unsigned long long units = -(long long) length;
+        if (units * 2 > bytes.length() - offset) return false;
+        for (unsigned long long i = 0; i + 1 < units; i++) {
+            unsigned int unit = (unsigned char) bytes[offset + 2*i] | (unsigned char) bytes[offset + 2*i + 1] << 8;
+            if (unit >= 0xD800 && unit < 0xDC00 && i + 2 < units) {
+                unsigned int low = (unsigned char) bytes[offset + 2*i + 2] | (unsigned char) bytes[offset + 2*i + 3] << 8;
+                if (low >= 0xDC00 && low < 0xE000) {
+                    unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                    i++;
+                }
+            }
+            appendUtf8(result, unit);
+        }
+        offset += units * 2;
+    }
+    if (end) *end = offset;
+    return true;
+}
+
+bool indexGvas(std::string_view saveData, GvasIndex &index, const std::vector<std::string> &stopAt) {
+    if (!saveData.starts_with(MAGIC_HEADER)) return false;
+    GvasCursor cursor = {saveData, 4, saveData.length()};
+    unsigned int saveGameVersion, packageVersion, ignored, customVersionCount;
+    std::string ignoredStr;
+    // Save game and package versions, UE5 saves have a second package version
+    if (!cursor.u32(saveGameVersion) || !cursor.u32(packageVersion)) return false;
+    if (saveGameVersion >= 3 && !cursor.u32(ignored)) return false;
+    // Engine version major/minor/patch, changelist, and branch
+    if (!cursor.skip(3*2 + 4) || !cursor.fString(ignoredStr)) return false;
+    // Custom versions
+    if (!cursor.u32(ignored) || !cursor.u32(customVersionCount)) return false;
+    if (!cursor.skip((unsigned long long) customVersionCount * GVAS_CUSTOM_VERSION_SIZE)) return false;
+    // Save game class name
+    if (!cursor.fString(ignoredStr)) return false;
+    indexProperties(cursor, index, stopAt, 0);
+    return true;
+}
+
+bool getGvasString(std::string_view saveData, const GvasIndex &index, const std::string &name, std::string &result) {
+    auto found = index.find(name);
+    if (found == index.end() || found->second.type != "StrProperty") return false;
+    unsigned long long end;
+    return readFString(saveData.substr(0, found->second.offset + found->second.size), found->second.offset, result, &end);
+}
+
+bool getGvasByteArray(std::string_view saveData, const GvasIndex &index, const std::string &name, std::string_view &result) {
+    auto found = index.find(name);
+    if (found == index.end() || found->second.type != "ArrayProperty" || found->second.innerType != "ByteProperty") return false;
+    const GvasProperty &property = found->second;
+    if (property.size < 4 || property.offset + property.size > saveData.length()) return false;
+    unsigned int count = readU32(saveData, property.offset);
+    if (count > property.size - 4) return false;
+    result = saveData.substr(property.offset + 4, count);
+    return true;
+}
@@ -0,0 +1,35 @@
+#ifndef LEGILIMENS_HOGWARTS_LEGACY_CPP_GVAS_H
+#define LEGILIMENS_HOGWARTS_LEGACY_CPP_GVAS_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#define GVAS_MAX_DEPTH 16
+#define GVAS_MAX_NAME_LENGTH 1024
+
+// A property found in a GVAS (Unreal Engine save game) file
+struct GvasProperty {
+    std::string type;          // e.g. "StrProperty", "ArrayProperty"
+    std::string innerType;     // Element type of arrays/sets, struct name of structs, empty otherwise
+    unsigned long long offset; // Start of the property's value, right after its header
+    unsigned long long size;   // Declared size of the property's value
+};
+
+// Property name -> the first property with that name
+typedef std::unordered_map<std::string, GvasProperty> GvasIndex;
+
+// Walks the header and properties of a save in a single forward pass, skipping every value by its declared size,
+// and adds each property (including ones nested in structs) to index. Returns whether the save had a valid header
+// If stopAt isn't empty, the walk stops as soon as all of those properties are found. saveData may be only the start of
+// a save, in which case the walk stops at the first property that doesn't fit in it
+bool indexGvas(std::string_view saveData, GvasIndex &index, const std::vector<std::string> &stopAt = {});
+// Reads an FString (UTF-8 or UTF-16) starting at offset, and returns whether it was successful
+bool readFString(std::string_view bytes, unsigned long long offset, std::string &result, unsigned long long *end = nullptr);
+// Sets result to the value of a StrProperty, and returns whether it was found
+bool getGvasString(std::string_view saveData, const GvasIndex &index, const std::string &name, std::string &result);
+// Points result at the bytes of an ArrayProperty of bytes, and returns whether it was found
+bool getGvasByteArray(std::string_view saveData, const GvasIndex &index, const std::string &name, std::string_view &result);
+
+#endif //LEGILIMENS_HOGWARTS_LEGACY_CPP_GVAS_H
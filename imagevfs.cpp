@@ -0,0 +1,233 @@
+#include "imagevfs.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#define IMAGE_SECTOR_SIZE 4096
+
+namespace {
+    // An open database file, pointing into a registered image
+    struct ImageFile {
+        sqlite3_file base;
+        std::string_view image;
+    };
+
+    std::mutex imagesMutex;
+    std::unordered_map<std::string, std::string_view> images;
+    std::atomic<unsigned long long> nextImageId = 0;
+
+    sqlite3_vfs *defaultVfs() {
+        static sqlite3_vfs *vfs = sqlite3_vfs_find(nullptr);
+        return vfs;
+    }
+
+    int imageClose(sqlite3_file *) {
+        return SQLITE_OK;
+    }
+
+    // Copies the requested page out of the image, zero filling anything past its end like SQLite expects
+    int imageRead(sqlite3_file *file, void *buffer, int amount, sqlite3_int64 offset) {
+        std::string_view image = reinterpret_cast<ImageFile *>(file)->image;
+        auto *out = static_cast<char *>(buffer);
+        std::size_t available = (offset < (sqlite3_int64) image.size()) ? std::min<std::size_t>(amount, image.size() - offset) : 0;
+        if (available > 0) std::memcpy(out, image.data() + offset, available);
+        if (available == (std::size_t) amount) return SQLITE_OK;
+        std::memset(out + available, 0, amount - available);
+        return SQLITE_IOERR_SHORT_READ;
+    }
+
+    int imageWrite(sqlite3_file *, const void *, int, sqlite3_int64) {
+        return SQLITE_READONLY;
+    }
+
+    int imageTruncate(sqlite3_file *, sqlite3_int64) {
+        return SQLITE_READONLY;
+    }
+
+    int imageSync(sqlite3_file *, int) {
+        return SQLITE_OK;
+    }
+
+    int imageFileSize(sqlite3_file *file, sqlite3_int64 *size) {
+        *size = (sqlite3_int64) reinterpret_cast<ImageFile *>(file)->image.size();
+        return SQLITE_OK;
+    }
+
+    // Nothing can write to an image, so locking is a no-op
+    int imageLock(sqlite3_file *, int) {
+        return SQLITE_OK;
+    }
+
+    int imageCheckReservedLock(sqlite3_file *, int *result) {
+        *result = 0;
+        return SQLITE_OK;
+    }
+
+    int imageFileControl(sqlite3_file *, int, void *) {
+        return SQLITE_NOTFOUND;
+    }
+
+    int imageSectorSize(sqlite3_file *) {
+        return IMAGE_SECTOR_SIZE;
+    }
+
+    int imageDeviceCharacteristics(sqlite3_file *) {
+        return SQLITE_IOCAP_IMMUTABLE;
+    }
+
+    const sqlite3_io_methods imageMethods = {
+            1,
+            imageClose,
+            imageRead,
+            imageWrite,
+            imageTruncate,
+            imageSync,
+            imageFileSize,
+            imageLock,
+            imageLock,
+            imageCheckReservedLock,
+            imageFileControl,
+            imageSectorSize,
+            imageDeviceCharacteristics,
+            // Only used by version 2 and later
+            nullptr, // xShmMap
+            nullptr, // xShmLock
+            nullptr, // xShmBarrier
+            nullptr, // xShmUnmap
+            nullptr, // xFetch
+            nullptr  // xUnfetch
+    };
+
+    // Opens a registered image, anything else (temp tables, journals, etc.) is opened by the default VFS
+    int imageOpen(sqlite3_vfs *, sqlite3_filename name, sqlite3_file *file, int flags, int *outFlags) {
+        if (name == nullptr || !(flags & SQLITE_OPEN_MAIN_DB)) {
+            return defaultVfs()->xOpen(defaultVfs(), name, file, flags, outFlags);
+        }
+        if (flags & (SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE)) return SQLITE_READONLY;
+        std::lock_guard<std::mutex> lock(imagesMutex);
+        auto found = images.find(name);
+        if (found == images.end()) return SQLITE_CANTOPEN;
+        auto *imageFile = reinterpret_cast<ImageFile *>(file);
+        imageFile->base.pMethods = &imageMethods;
+        imageFile->image = found->second;
+        if (outFlags) *outFlags = SQLITE_OPEN_READONLY;
+        return SQLITE_OK;
+    }
+
+    int imageDelete(sqlite3_vfs *, const char *name, int syncDir) {
+        return defaultVfs()->xDelete(defaultVfs(), name, syncDir);
+    }
+
+    // Images never have journals, other files are checked by the default VFS
+    int imageAccess(sqlite3_vfs *, const char *name, int flags, int *result) {
+        {
+            std::lock_guard<std::mutex> lock(imagesMutex);
+            if (images.contains(name)) {
+                *result = (flags != SQLITE_ACCESS_READWRITE);
+                return SQLITE_OK;
+            }
+        }
+        std::string_view nameView(name);
+        for (const auto &suffix : {"-journal", "-wal"}) {
+            if (nameView.ends_with(suffix)) {
+                std::lock_guard<std::mutex> lock(imagesMutex);
+                if (images.contains(std::string(nameView.substr(0, nameView.length() - std::strlen(suffix))))) {
+                    *result = 0;
+                    return SQLITE_OK;
+                }
+            }
+        }
+        return defaultVfs()->xAccess(defaultVfs(), name, flags, result);
+    }
+
+    // Image names aren't real paths, so they're kept as they are
+    int imageFullPathname(sqlite3_vfs *, const char *name, int outSize, char *out) {
+        sqlite3_snprintf(outSize, out, "%s", name);
+        return SQLITE_OK;
+    }
+
+    void *imageDlOpen(sqlite3_vfs *, const char *name) {
+        return defaultVfs()->xDlOpen(defaultVfs(), name);
+    }
+
+    void imageDlError(sqlite3_vfs *, int size, char *message) {
+        defaultVfs()->xDlError(defaultVfs(), size, message);
+    }
+
+    void (*imageDlSym(sqlite3_vfs *, void *handle, const char *symbol))() {
+        return defaultVfs()->xDlSym(defaultVfs(), handle, symbol);
+    }
+
+    void imageDlClose(sqlite3_vfs *, void *handle) {
+        defaultVfs()->xDlClose(defaultVfs(), handle);
+    }
+
+    int imageRandomness(sqlite3_vfs *, int size, char *out) {
+        return defaultVfs()->xRandomness(defaultVfs(), size, out);
+    }
+
+    int imageSleep(sqlite3_vfs *, int microseconds) {
+        return defaultVfs()->xSleep(defaultVfs(), microseconds);
+    }
+
+    int imageCurrentTime(sqlite3_vfs *, double *time) {
+        return defaultVfs()->xCurrentTime(defaultVfs(), time);
+    }
+
+    int imageGetLastError(sqlite3_vfs *, int size, char *message) {
+        return defaultVfs()->xGetLastError ? defaultVfs()->xGetLastError(defaultVfs(), size, message) : 0;
+    }
+
+    // Registers the VFS with SQLite the first time it's needed
+    bool registerImageVfs() {
+        static bool registered = [] {
+            if (sqlite3_initialize() != SQLITE_OK || defaultVfs() == nullptr) return false;
+            static sqlite3_vfs vfs = {
+                    1,
+                    std::max<int>(sizeof(ImageFile), defaultVfs()->szOsFile),
+                    defaultVfs()->mxPathname,
+                    nullptr,
+                    IMAGE_VFS_NAME,
+                    nullptr,
+                    imageOpen,
+                    imageDelete,
+                    imageAccess,
+                    imageFullPathname,
+                    imageDlOpen,
+                    imageDlError,
+                    imageDlSym,
+                    imageDlClose,
+                    imageRandomness,
+                    imageSleep,
+                    imageCurrentTime,
+                    imageGetLastError,
+                    // Only used by version 2 and later
+                    nullptr, // xCurrentTimeInt64
+                    nullptr, // xSetSystemCall
+                    nullptr, // xGetSystemCall
+                    nullptr  // xNextSystemCall
+            };
+            return sqlite3_vfs_register(&vfs, 0) == SQLITE_OK;
+        }();
+        return registered;
+    }
+}
+
+std::string registerDBImage(std::string_view image) {
+    std::string name = "legilimens-image-" + std::to_string(nextImageId++) + ".db";
+    std::lock_guard<std::mutex> lock(imagesMutex);
+    images[name] = image;
+    return name;
+}
+
+void unregisterDBImage(const std::string &name) {
+    std::lock_guard<std::mutex> lock(imagesMutex);
+    images.erase(name);
+}
+
+std::string getDBImageUri(const std::string &name) {
+    if (!registerImageVfs()) return "";
+    return "file:" + name + "?vfs=" IMAGE_VFS_NAME "&mode=ro";
+}
@@ -0,0 +1,21 @@
+#ifndef LEGILIMENS_HOGWARTS_LEGACY_CPP_IMAGEVFS_H
+#define LEGILIMENS_HOGWARTS_LEGACY_CPP_IMAGEVFS_H
+
+#include <string>
+#include <string_view>
+#include "sqlite3.h"
+
+#define IMAGE_VFS_NAME "legilimens-image"
+
+// Read-only SQLite VFS that serves database files straight out of byte ranges in memory (e.g. a mapped .sav file),
+// so the database never has to be copied out of the save. Temporary files are passed on to the default VFS
+
+// Registers image as a database file, and returns the file name to open it with. image must outlive every connection to it
+std::string registerDBImage(std::string_view image);
+// Removes a database file registered with registerDBImage
+void unregisterDBImage(const std::string &name);
+// Gets the URI to open or attach a registered database file with (read-only, through this VFS), empty if the VFS couldn't be registered
+// Connections using it must be opened with SQLITE_OPEN_URI
+std::string getDBImageUri(const std::string &name);
+
+#endif //LEGILIMENS_HOGWARTS_LEGACY_CPP_IMAGEVFS_H
@@ -3,18 +3,32 @@
 #include <cstdio>
 #include <filesystem>
 #include <unordered_set>
-#include <map>
-#include <regex>
-#include "sqlite3.h"
+#include <charconv>
+#include <mutex>
+#include <array>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 #include "collectibles.h"
 #include "getsave.h"
+#include "analysis.h"
+#include "tokens.h"
+#include "workers.h"
+#include "output.h"
+#include "report.h"
+#include "profile.h"
 #include "tabulate.hpp"
 #include "argparse.hpp"
 #include "color.hpp"
 
-#define DB_IMAGE_STR "RawDatabaseImage"
 #define VERSION "0.2.4"
 #define DEFAULT_OUTPUT_FILE "legilimens-output-{TIMESTAMP}.txt"
+#define DEFAULT_DB_MODE "image"
+#define DEFAULT_FORMAT "table"
+#define DEFAULT_READER "sqlite"
+#define BATCH_HEADER "path\tstatus\tmissing\tbutterfly_bug\tconjuration_bug\tmissing_keys\terrors"
+#define SERVER_MAX_DATA_SIZE (1ULL << 30)
 
 // Writes title to stream
 void printTitle(std::ostream &stream) {
@@ -45,11 +59,22 @@ argparse::ArgumentParser parseArgs(int argc, char *argv[], bool &success) {
     argparse::ArgumentParser program("Legilimens", VERSION);
     program.add_argument("file").default_value(std::string{""}).help("Path of your .sav Hogwarts Legacy save file. Will be prompted if empty");
     program.add_argument("--dont-confirm-exit").default_value(false).implicit_value(true).help("Gets rid of the \"Press enter to close this window...\" prompt");
+    program.add_argument("--db-mode").default_value(std::string{DEFAULT_DB_MODE}).help("How to load the save's database: \"image\" reads it in place, \"memory\" copies it into SQLite, \"file\" writes it to a temporary file. Only needed if the default fails");
     program.add_argument("-o", "--output-file").default_value(std::string{DEFAULT_OUTPUT_FILE}).nargs(argparse::nargs_pattern::optional).help("File to write output to. To not write to file, use -o without passing a filename");
     std::string filters;
     for ( const auto &filter : filterOptions ) {
-        filters += filter.cli + ", ";
-    }
+        filters += std::string(filter.cli) + ", ";
+    }
+    program.add_argument("--format").default_value(std::string{DEFAULT_FORMAT}).help("Output format: \"table\" for people, or \"json\" to write a JSON object per save for other programs, without any prompts. A save file is required for a single save");
+    program.add_argument("--batch").nargs(argparse::nargs_pattern::at_least_one).help("Analyzes every given save, folder of saves, or pattern like HL-01-*.sav without any prompts, and writes one tab separated record per save to stdout, or to the file given with -o");
+    program.add_argument("-j", "--jobs").scan<'u', unsigned int>().help("Number of saves to analyze at once in batch mode. Defaults to the number of CPU cores");
+    program.add_argument("--reader").default_value(std::string{DEFAULT_READER}).help("What reads the save's database: \"sqlite\", \"native\" to read its tables directly and only use SQLite for what that can't read, or \"verify\" to use both and report any difference");
+    program.add_argument("--salvage").default_value(false).implicit_value(true).help("If parts of the save's database are corrupt, recover whatever is still readable from them instead of skipping the affected collectible types");
+    program.add_argument("--query-jobs").scan<'u', unsigned int>().default_value(1u).help("Number of connections reading each save's tables at once. More can make a single save faster on multi-core CPUs");
+    program.add_argument("--server").default_value(false).implicit_value(true).help("Keeps running and answers requests on stdin, one per line: \"PATH <save>\", \"DATA <size>\" followed by the save's bytes, or \"QUIT\". Each is answered with one --batch record on stdout");
+    program.add_argument("--diff").nargs(0, 2).help("Compares two saves, the previous and then the latest, and only shows what was collected between them. Without saves, compares the two latest saves of a character");
+    program.add_argument("--profile").default_value(false).implicit_value(true).help("Prints how long each stage took once done");
+    program.add_argument("--trace-file").help("Also writes every stage as a Chrome trace to this file, which chrome://tracing or https://ui.perfetto.dev can open. Implies --profile");
     program.add_argument("--filters").nargs(argparse::nargs_pattern::any).help("Only show certain collectibles. Will be prompted if empty. Can any combination of " + filters.substr(0, filters.length()-2));
     program.add_epilog("Example: Legilimens.exe C:/path/to/HL-00-00.sav --filters PAGES DAEDALIAN CHESTS");
     try {
@@ -64,6 +89,7 @@ argparse::ArgumentParser parseArgs(int argc, char *argv[], bool &success) {
 }
 
 // Gets the first available file path temp_X.db to temporarily store the database, return whether it was successful
+// Only used by the "--db-mode file" fallback, the database is normally read in memory
 bool getTempDBFile(const std::filesystem::path &exePath, std::filesystem::path &dbFile) {
     for (int i = 0; i < 1000; i++) {
         dbFile = exePath.parent_path() / ("temp_" + std::to_string(i) + ".db");
@@ -73,201 +99,11 @@ bool getTempDBFile(const std::filesystem::path &exePath, std::filesystem::path &
     return false;
 }
 
-// Sets dbData to the content of the database contained in the saveFile, and returns whether it was successful
-bool extractDB(const std::filesystem::path &saveFile, std::string &dbData) {
-    // Check file existence
-    if (!std::filesystem::exists(saveFile)) {
-        std::cerr << dye::red("Legilimens was not able to find the file \"" + saveFile.string() + "\"") << std::endl;
-        return false;
-    }
-    // Check for other errors
-    std::ifstream fs(saveFile, std::ios::in|std::ios::binary);
-    if (!fs.is_open()) {
-        std::cerr << dye::red("Legilimens encountered an error reading the file \"" + saveFile.string() + "\"") << std::endl;
-        return false;
-    }
-    // Read the file
-    std::ostringstream sstr;
-    sstr << fs.rdbuf();
-    std::string saveData = sstr.str();
-    fs.close();
-    // Check magic header
-    if (!saveData.starts_with(MAGIC_HEADER)) {
-        std::cerr << dye::red("File \"" + saveFile.string() + "\" doesn't seem to be a Hogwarts Legacy save file") << std::endl;
-        return false;
-    }
-    // Find DB offset and size
-    std::size_t found = saveData.find(DB_IMAGE_STR);
-    if (found == std::string::npos || found + 65 >= saveData.length()) {
-        std::cerr << dye::red("Legilimens was unable to find the SQL database in your save file") << std::endl;
-        return false;
-    }
-    unsigned long long dbStartIndex = found + 65;
-    unsigned int dbSize = readU32(saveData, dbStartIndex-4);
-    // Extract DB
-    dbData = saveData.substr(dbStartIndex, dbSize);
-    return true;
-}
-
-// Runs a query
-void runQuery(sqlite3* db, sqlite3_stmt* stmt, int index, std::vector<std::unordered_set<std::string>> &queryResults, std::unordered_set<TableEnum> &queryErrors) {
-    try {
-        if (sqlite3_prepare_v2(db, tables[index].query.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-            queryErrors.insert(TableEnum(index));
-        } else if (!tables[index].oneRow) {
-            while (sqlite3_step(stmt) != SQLITE_DONE) {
-                queryResults[index].insert(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0)));
-            }
-        } else {
-            // Each row is a comma separated list of entries rather than one entry
-            std::regex re("\\w+");
-            std::string commaSepList;
-            while (sqlite3_step(stmt) != SQLITE_DONE) {
-                commaSepList = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
-                for (std::sregex_iterator i = std::sregex_iterator(commaSepList.begin(), commaSepList.end(), re); i != std::sregex_iterator(); i++) {
-                    queryResults[index].insert(i->str());
-                }
-            }
-        }
-    } catch (const std::logic_error& sqlErr) {
-        queryErrors.insert(TableEnum(index));
-    }
-    sqlite3_finalize(stmt);
-}
-
-// Read the tables in the database, and returns whether it was successful
-bool readDB(const std::filesystem::path &saveFile, const std::filesystem::path &dbFile, std::vector<std::unordered_set<std::string>> &queryResults, std::unordered_set<TableEnum> &queryErrors) {
-    // Create a new file containing the database
-    std::string dbData;
-    if (!extractDB(saveFile, dbData)) return false;
-    std::ofstream fs(dbFile.string(), std::ios::out|std::ios::binary);
-    if (!fs.is_open()) {
-        std::cerr << dye::red("Legilimens was unable to write the database to a new file") << std::endl;
-        return false;
-    }
-    fs << dbData;
-    fs.close();
-    // Connect with sqlite3
-    sqlite3* db;
-    sqlite3_stmt* stmt;
-    int err = sqlite3_open(dbFile.string().c_str(), &db);
-    if (err == SQLITE_OK) {
-        // Run each query
-        for (int i = 0; i < tables.size(); i++) {
-            runQuery(db, stmt, i, queryResults, queryErrors);
-        }
-    } else {
-        std::cerr << dye::red("SQLite was unable to read the database") << std::endl;
-    }
-    if (queryErrors.size() == tables.size()) {
-        std::cerr << dye::red("SQLite was unable to read the database") << std::endl;
-        err = SQLITE_ERROR;
-    }
-    sqlite3_close(db);
-    // Remove database file
-    std::error_code ec;
-    if (std::filesystem::exists(dbFile) && !std::filesystem::remove(dbFile, ec)) {
-        std::cerr << dye::red("Error removing database file \"" + dbFile.string() + "\"") << std::endl;
-        std::cerr << dye::red(ec.message()) << std::endl;
-    }
-    return (err == SQLITE_OK);
-}
-
-// Adds a row to the table for the given collectible when sorting by region
-void addRegionTableRow(tabulate::Table &table, const CollectibleStruct& collectible) {
-    CollectibleType type = collectibleTypes[collectible.type];
-    std::string name = (collectible.type == FinishingTouchEnemy) ? collectible.index : type.timestampName + " #" + collectible.index;
-    std::string video = "No video yet";
-    if (collectible.video != UINT8_MAX) {
-        video = "https://youtu.be/" + videoIds[collectible.video] + "&t=" + std::to_string(collectible.timestamp);
-    }
-    table.add_row({name, type.timeStampParen, video});
-    tabulate::Color color = tabulate::Color::white;
-    if (type.timestampName == "Field guide page") {
-        color = tabulate::Color::cyan;
-    } else if (type.timestampName == "Demiguise Moon") {
-        color = tabulate::Color::blue;
-    } else if (type.timestampName == "Merlin Trial") {
-        color = tabulate::Color::green;
-    } else if (type.timestampName == "Butterfly Chest") {
-        color = tabulate::Color::yellow;
-    } else if (type.timestampName == "Collection Chest") {
-        color = tabulate::Color::magenta;
-    }
-    table[table.size()-1].format().font_color(color);
-}
-
-// Gets a header table for the given region
-tabulate::Table getRegionHeaderTable(RegionEnum region) {
-    tabulate::Table table;
-    RegionStruct regionInfo = regions[region];
-    if (regionInfo.globalRegion.empty()) {
-        table.add_row({regionInfo.name});
-    } else {
-        table.add_row({regionInfo.globalRegion + " - " + regionInfo.name});
-    }
-    table[0].format().font_align(tabulate::FontAlign::center).hide_border().width(TABLE_WIDTH).padding_bottom(0);
-    return table;
-}
-
-// Gets a table for the given region
-tabulate::Table getRegionTable() {
-    tabulate::Table table;
-    table.add_row({"Item", "Type", "Location"});
-    table.column(0).format().width(27);
-    table.column(1).format().width(TABLE_WIDTH - 64 - 2);
-    table.column(2).format().width(37);
-    return table;
-}
-
-// Adds a row to the table for the given collectible when sorting by type
-void addTypeTableRow(tabulate::Table &table, const CollectibleStruct& collectible) {
-    CollectibleType type = collectibleTypes[collectible.type];
-    RegionStruct regionInfo = regions[collectible.region];
-    std::string name = (collectible.type == FinishingTouchEnemy) ? collectible.index : regionInfo.name + " #" + collectible.index;
-    std::string video = "No video yet";
-    if (collectible.video != UINT8_MAX) {
-        video = "https://youtu.be/" + videoIds[collectible.video] + "&t=" + std::to_string(collectible.timestamp);
-    }
-    table.add_row({name, video});
-    tabulate::Color color = tabulate::Color::white;
-    if (type.timestampName == "Field guide page") {
-        color = tabulate::Color::cyan;
-    } else if (type.timestampName == "Demiguise Moon") {
-        color = tabulate::Color::blue;
-    } else if (type.timestampName == "Merlin Trial") {
-        color = tabulate::Color::green;
-    } else if (type.timestampName == "Butterfly Chest") {
-        color = tabulate::Color::yellow;
-    } else if (type.timestampName == "Collection Chest") {
-        color = tabulate::Color::magenta;
-    }
-    table[table.size()-1].format().font_color(color);
-}
-
-// Gets a header table for the given collectible type
-tabulate::Table getTypeHeaderTable(CollectibleEnum type) {
-    tabulate::Table table;
-    CollectibleType collectibleInfo = collectibleTypes[type];
-    if (!collectibleInfo.sortByTypeName.empty()) {
-        table.add_row({collectibleInfo.sortByTypeName});
-    } else if (collectibleInfo.timeStampParen.empty()) {
-        table.add_row({collectibleInfo.timestampName});
-    } else {
-        table.add_row({collectibleInfo.timestampName + " - " + collectibleInfo.timeStampParen});
-    }
-    table[0].format().font_align(tabulate::FontAlign::center).hide_border().width(TABLE_WIDTH).padding_bottom(0);
-    return table;
-}
-
-// Gets a table for the given collectible type
-tabulate::Table getTypeTable() {
-    tabulate::Table table;
-    table.add_row({"Item", "Location"});
-    table.column(0).format().width(TABLE_WIDTH - 37 - 1);
-    table.column(1).format().width(37);
-    return table;
-}
+// How results are written: tables for people (tab separated records with --batch and --server), or JSON for programs
+enum OutputFormat {
+    TableFormat = 0,
+    JsonFormat = 1
+};
 
 // Adds the given filter's types to the allowed types
 void addFilterTypes(const Filter& filter, std::unordered_set<CollectibleEnum> &allowedTypes, bool &sortByType) {
@@ -280,10 +116,16 @@ void addFilterTypes(const Filter& filter, std::unordered_set<CollectibleEnum> &a
     }
 }
 
-// Gets the list of filters to use, returns true if sorting by type instead of location
-bool getFilters(const std::vector<std::string> &filters, std::unordered_set<CollectibleEnum> &allowedTypes) {
+// Gets every collectible of the allowed types
+CollectibleSet getAllowedCollectibles(const std::unordered_set<CollectibleEnum> &allowedTypes) {
+    CollectibleSet allowed;
+    for (CollectibleEnum type : allowedTypes) allowed |= getTypeMask(type);
+    return allowed;
+}
+
+// Adds the types of the filters passed as command line args to the allowed types, returns true if sorting by type
+bool parseFilters(const std::vector<std::string> &filters, std::unordered_set<CollectibleEnum> &allowedTypes) {
     bool sortByType = false;
-    // Check command line args
     for ( const auto &filter : filters ) {
         for ( const auto &option : filterOptions ) {
             if (filter == option.cli) {
@@ -292,6 +134,13 @@ bool getFilters(const std::vector<std::string> &filters, std::unordered_set<Coll
             }
         }
     }
+    return sortByType;
+}
+
+// Gets the list of filters to use, returns true if sorting by type instead of location
+bool getFilters(const std::vector<std::string> &filters, std::unordered_set<CollectibleEnum> &allowedTypes) {
+    // Check command line args
+    bool sortByType = parseFilters(filters, allowedTypes);
     if (!allowedTypes.empty()) return sortByType;
     // Prompt user
     tabulate::Table table;
@@ -318,12 +167,14 @@ bool getFilters(const std::vector<std::string> &filters, std::unordered_set<Coll
     std::cout << "Which collectible types would you like to view? (e.g. \"2 3 5 8\"):" << std::endl;
     std::string line;
     std::getline(std::cin, line);
-    std::regex re("\\d+");
+    Tokenizer choices(line, isDigitChar);
+    std::string_view token;
     unsigned long long choice;
-    for (std::sregex_iterator i = std::sregex_iterator(line.begin(), line.end(), re); i != std::sregex_iterator(); i++) {
-        choice = std::stoull(i->str());
-        if (choice < filterOptions.size()) {
-            addFilterTypes(filterOptions[std::stoull(i->str())], allowedTypes, sortByType);
+    while (choices.next(token)) {
+        // Numbers too big for choice can't be a valid choice either
+        auto [end, ec] = std::from_chars(token.data(), token.data() + token.length(), choice);
+        if (ec == std::errc() && choice < filterOptions.size()) {
+            addFilterTypes(filterOptions[choice], allowedTypes, sortByType);
         }
     }
     // If no types specified, allow all types
@@ -333,41 +184,20 @@ bool getFilters(const std::vector<std::string> &filters, std::unordered_set<Coll
     return sortByType;
 }
 
-// Returns whether the save is affected by the butterfly quest bug
-// i.e. "Follow the Butterflies" is complete, but Butterfly Chest #1 is not collected
-bool hasButterlyBug(std::vector<std::unordered_set<std::string>> &queryResults, std::unordered_set<TableEnum> &queryErrors) {
-    if (queryErrors.contains(EconomicExpiryDynamic) || queryErrors.contains(PlayerStatsDynamic)) return false;
-    // Check if the butterfly mission is completed
-    if (!queryResults[PlayerStatsDynamic].contains("COM_11")) return false;
-    // Get the quest's butterfly chest
-    for ( const auto &collectible : collectibles ) {
-        if (collectible.type == ButterflyChest && collectible.index == "1") {
-            // If it hasn't been collected, then the bug happened
-            return !queryResults[collectibleTypes[ButterflyChest].table].contains(collectible.key);
-        }
+// Prints the messages about anything that went wrong while analyzing a save
+void printErrors(const std::vector<std::string> &errors) {
+    for ( const auto &error : errors ) {
+        std::cerr << dye::red(error) << std::endl;
     }
-    return false; // Should never reach here
 }
 
-// Returns whether the save is affected by the missing conjuration bug
-// i.e. the save has one less conjuration than conjuration chests collected
-bool hasConjurationBug(std::vector<std::unordered_set<std::string>> &queryResults, std::unordered_set<TableEnum> &queryErrors, const unsigned long conjurationChestsOpened) {
-    if (queryErrors.contains(CollectionDynamic2) || queryErrors.contains(LootDropComponentDynamic) || queryErrors.contains(EconomicExpiryDynamic) || queryErrors.contains(MapLocationDataDynamic)) return false;
-    // Check if more chests than conjurations
-    return (conjurationChestsOpened > queryResults[CollectionDynamic2].size());
-}
-
-// Runs Legilimens and returns whether it was successful
-bool legilimize(const std::filesystem::path& saveFile, const std::filesystem::path &dbFile, const std::filesystem::path &outFile, const std::vector<std::string> &filters) {
-    // Query all the necessary tables
-    std::vector<std::unordered_set<std::string>> queryResults(tables.size());
-    std::unordered_set<TableEnum> queryErrors;
-    if (!readDB(saveFile, dbFile, queryResults, queryErrors)) return false;
-    if (!queryErrors.empty()) {
+// Prints which collectible types couldn't be read, or were salvaged from damaged parts of the database
+void printQueryProblems(const Analysis &analysis) {
+    if (!analysis.queryErrors.empty()) {
         std::cerr << dye::red("SQLite was unable to read parts of the database") << std::endl;
         std::cerr << dye::red("The following collectible types were affected and won't work correctly:") << std::endl;
         bool first = true;
-        for ( const auto &sqlTable : queryErrors ) {
+        for ( const auto &sqlTable : analysis.queryErrors ) {
             for ( const auto &collectibleType : tables[sqlTable].affected ) {
                 if (!first) std::cerr << dye::red(", ");
                 first = false;
@@ -376,97 +206,248 @@ bool legilimize(const std::filesystem::path& saveFile, const std::filesystem::pa
         }
         std::cerr << std::endl;
     }
-    std::unordered_set<CollectibleEnum> allowedTypes;
-    bool sortByType = getFilters(filters, allowedTypes);
-    // Get the missing collectibles in each region
-    std::map<RegionEnum, std::vector<CollectibleStruct>> missingByRegion;
-    std::map<CollectibleEnum, std::vector<CollectibleStruct>> missingByType;
-    unsigned long conjurationChestsOpened = 0;
-    CollectibleEnum cType;
-    TableEnum cTable;
-    for ( const auto &collectible : collectibles ) {
-        cType = collectible.type;
-        cTable = collectibleTypes[cType].table;
-        if (queryErrors.contains(cTable)) continue;
-        // If collected
-        if (queryResults[cTable].contains(collectible.key)) {
-            if (cType == MiscConjChest || cType == ArithmancyChest || cType == DungeonChest || cType == ButterflyChest || cType == VivariumChest) {
-                conjurationChestsOpened += 1;
+    if (!analysis.salvagedQueries.empty()) {
+        std::cerr << dye::red("The following collectible types were salvaged from damaged parts of the database, and may not be accurate:") << std::endl;
+        bool first = true;
+        for ( const auto &sqlTable : analysis.salvagedQueries ) {
+            for ( const auto &collectibleType : tables[sqlTable].affected ) {
+                if (!first) std::cerr << dye::red(", ");
+                first = false;
+                std::cerr << dye::red(collectibleType);
             }
-            continue;
-        }
-        // If not included in filter
-        if (!allowedTypes.contains(cType)) continue;
-        // If not collected
-        if (sortByType) {
-            missingByType[cType].push_back(collectible);
-        } else {
-            missingByRegion[collectible.region].push_back(collectible);
         }
+        std::cerr << std::endl;
     }
-    // Open output file
+}
+
+// Runs Legilimens and returns whether it was successful
+bool legilimize(const std::filesystem::path& saveFile, SaveCache &cache, const AnalysisOptions &options, const std::filesystem::path &outFile, const std::vector<std::string> &filters) {
+    // Query all the necessary tables
+    Analysis analysis;
+    bool success = analyzeSave(saveFile, cache, options, analysis);
+    printErrors(analysis.errors);
+    if (!success) return false;
+    printQueryProblems(analysis);
+    std::unordered_set<CollectibleEnum> allowedTypes;
+    bool sortByType = getFilters(filters, allowedTypes);
+    // Missing collectibles included in the filter, which are split by region or type below
+    CollectibleSet shown = analysis.missing & getAllowedCollectibles(allowedTypes);
+    // Everything below is rendered once and written to the console and the output file, which doesn't get colors
+    Output output;
+    output.addSink(std::cout, enableConsoleColors());
     std::ofstream fs = nullptr;
     if (!outFile.empty()) {
         fs = std::ofstream(outFile.string(), std::ios::out);
         if (fs.is_open()) {
             printTitle(fs);
             fs << std::endl << "Selected save file:" << std::endl << saveFile.string() << std::endl;
+            output.addSink(fs, false);
         }
     }
-    if (missingByRegion.empty() && missingByType.empty()) {
+    std::ostream &out = output.stream();
+    if (shown.none()) {
         // Nothing was missing
-        std::cout << std::endl << "Congratulations! You've gotten every collectible that Legilimens can detect." << std::endl;
-        if (fs && fs.is_open()) {
-            fs << std::endl << "Congratulations! You've gotten every collectible that Legilimens can detect." << std::endl;
+        out << std::endl << "Congratulations! You've gotten every collectible that Legilimens can detect." << std::endl;
+    } else {
+        writeMissingTables(out, shown, sortByType);
+    }
+    // Check for bugs
+    if (analysis.butterflyBug) {
+        out << std::endl << termcolor::red << "Your save seems to be affected by the butterfly quest bug. If you're unable to collect Butterfly Chest #1,\nconsider using https://hogwarts-legacy-save-editor.vercel.app or https://www.nexusmods.com/hogwartslegacy/mods/778 to fix it." << termcolor::reset << std::endl;
+    }
+    if (analysis.conjurationBug) {
+        out << std::endl << termcolor::red << "Your save seems to be affected by the 139/140 conjuration bug. If you can't find your last\nexploration conjuration, consider using https://www.nexusmods.com/hogwartslegacy/mods/832 to fix it." << termcolor::reset << std::endl;
+    }
+    {
+        ProfileSpan span("output", "flush");
+        output.flush();
+    }
+    if (fs && fs.is_open()) {
+        fs.close();
+    }
+    return true;
+}
+
+// Returns whether name matches pattern, where * matches any run of characters and ? matches any one character
+bool matchesWildcard(std::string_view name, std::string_view pattern) {
+    std::size_t n = 0, p = 0, starP = std::string_view::npos, starN = 0;
+    while (n < name.length()) {
+        if (p < pattern.length() && (pattern[p] == '?' || pattern[p] == name[n])) {
+            n++;
+            p++;
+        } else if (p < pattern.length() && pattern[p] == '*') {
+            starP = p++;
+            starN = n;
+        } else if (starP != std::string_view::npos) {
+            p = starP + 1;
+            n = ++starN;
+        } else {
+            return false;
         }
-    } else if (sortByType) {
-        // Sort by type
-        tabulate::Table table, headerTable;
-        for ( const auto &p : missingByType ) {
-            headerTable = getTypeHeaderTable(p.first);
-            table = getTypeTable();
-            for (const auto &collectible : p.second) {
-                addTypeTableRow(table, collectible);
+    }
+    while (p < pattern.length() && pattern[p] == '*') p++;
+    return p == pattern.length();
+}
+
+// Gets every save to analyze in batch mode. Each argument can be a save, a folder (every .sav file directly in it),
+// or a file name pattern with * and ? wildcards, e.g. C:/saves/HL-01-*.sav
+std::vector<std::filesystem::path> getBatchSaves(const std::vector<std::string> &args) {
+    std::vector<std::filesystem::path> result;
+    for ( const auto &arg : args ) {
+        std::filesystem::path path(arg);
+        std::vector<std::filesystem::path> matches;
+        std::error_code ec;
+        if (std::filesystem::is_directory(path, ec)) {
+            for (auto const& file : std::filesystem::directory_iterator{path, ec}) {
+                if (file.is_regular_file(ec) && file.path().extension() == ".sav") matches.push_back(file.path());
             }
-            table.column(1).format().font_align(tabulate::FontAlign::center);
-            std::cout << std::endl << std::endl << headerTable << std::endl << table << std::endl;
-            if (fs && fs.is_open()) {
-                fs << std::endl << std::endl << headerTable << std::endl << table << std::endl;
+        } else if (arg.find_first_of("*?") != std::string::npos) {
+            std::filesystem::path folder = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+            std::string pattern = path.filename().string();
+            for (auto const& file : std::filesystem::directory_iterator{folder, ec}) {
+                if (file.is_regular_file(ec) && matchesWildcard(file.path().filename().string(), pattern)) matches.push_back(file.path());
             }
+        } else {
+            matches.push_back(path);
         }
-    } else {
-        // Sort by region
-        tabulate::Table table, headerTable;
-        for ( const auto &p : missingByRegion ) {
-            headerTable = getRegionHeaderTable(p.first);
-            table = getRegionTable();
-            for (const auto &collectible : p.second) {
-                addRegionTableRow(table, collectible);
-            }
-            table.column(1).format().font_align(tabulate::FontAlign::center);
-            std::cout << std::endl << std::endl << headerTable << std::endl << table << std::endl;
-            if (fs && fs.is_open()) {
-                fs << std::endl << std::endl << headerTable << std::endl << table << std::endl;
-            }
+        std::sort(matches.begin(), matches.end());
+        result.insert(result.end(), matches.begin(), matches.end());
+    }
+    return result;
+}
+
+// Gets the status of a save's analysis: "ok", "partial" if some of its tables couldn't be read or were salvaged, or "error"
+std::string getStatus(bool success, const Analysis &analysis) {
+    if (!success) return "error";
+    return analysis.queryErrors.empty() && analysis.salvagedQueries.empty() ? "ok" : "partial";
+}
+
+// Gets the result record of a single save in batch mode, a tab separated line. See BATCH_HEADER for the columns
+std::string getBatchRecord(const std::filesystem::path &saveFile, bool success, const Analysis &analysis, const std::unordered_set<CollectibleEnum> &allowedTypes) {
+    std::string missingKeys, errors;
+    CollectibleSet shown = analysis.missing & getAllowedCollectibles(allowedTypes);
+    unsigned long missingCount = shown.count();
+    for (int i = 0; i < collectibles.size(); i++) {
+        if (!shown.test(i)) continue;
+        if (!missingKeys.empty()) missingKeys += ",";
+        missingKeys += collectibles[i].key.text;
+    }
+    for ( const auto &error : analysis.errors ) {
+        if (!errors.empty()) errors += "; ";
+        errors += error;
+    }
+    for ( const auto &sqlTable : analysis.queryErrors ) {
+        for ( const auto &collectibleType : tables[sqlTable].affected ) {
+            if (!errors.empty()) errors += "; ";
+            errors += "Unable to read " + std::string(collectibleType);
         }
     }
-    // Check for bugs
-    if (hasButterlyBug(queryResults, queryErrors)) {
-        std::cout << std::endl << dye::red("Your save seems to be affected by the butterfly quest bug. If you're unable to collect Butterfly Chest #1,\nconsider using https://hogwarts-legacy-save-editor.vercel.app or https://www.nexusmods.com/hogwartslegacy/mods/778 to fix it.") << std::endl;
-        if (fs && fs.is_open()) {
-            fs << std::endl << dye::red("Your save seems to be affected by the butterfly quest bug. If you're unable to collect Butterfly Chest #1,\nconsider using https://hogwarts-legacy-save-editor.vercel.app or https://www.nexusmods.com/hogwartslegacy/mods/778 to fix it.") << std::endl;
+    if (!success) missingCount = 0;
+    return saveFile.string() + "\t" + getStatus(success, analysis) + "\t" + std::to_string(missingCount) + "\t" +
+           (analysis.butterflyBug ? "1" : "0") + "\t" + (analysis.conjurationBug ? "1" : "0") + "\t" + missingKeys + "\t" + errors;
+}
+
+// Appends the details of each collectible in shown to out as a JSON array
+void appendJsonCollectibles(std::string &out, const CollectibleSet &shown) {
+    out += '[';
+    bool first = true;
+    for (int i = 0; i < collectibles.size(); i++) {
+        if (!shown.test(i)) continue;
+        const CollectibleStruct *collectible = &collectibles[i];
+        if (!first) out += ",";
+        first = false;
+        out += "{\"type\":";
+        appendJsonString(out, collectibleTypes[collectible->type].name);
+        out += ",\"key\":";
+        appendJsonString(out, collectible->key.text);
+        out += ",\"region\":";
+        appendJsonString(out, regions[collectible->region].name);
+        out += ",\"index\":";
+        appendJsonString(out, collectible->index);
+        std::string video = getVideoUrl(*collectible);
+        out += ",\"video\":";
+        if (video.empty()) {
+            out += "null,\"timestamp\":null}";
+        } else {
+            appendJsonString(out, video);
+            out += ",\"timestamp\":" + std::to_string(collectible->timestamp) + "}";
         }
     }
-    if (hasConjurationBug(queryResults, queryErrors, conjurationChestsOpened)) {
-        std::cout << std::endl << dye::red("Your save seems to be affected by the 139/140 conjuration bug. If you can't find your last\nexploration conjuration, consider using https://www.nexusmods.com/hogwartslegacy/mods/832 to fix it.") << std::endl;
-        if (fs && fs.is_open()) {
-            fs << std::endl << dye::red("Your save seems to be affected by the 139/140 conjuration bug. If you can't find your last\nexploration conjuration, consider using https://www.nexusmods.com/hogwartslegacy/mods/832 to fix it.") << std::endl;
+    out += ']';
+}
+
+// Gets the result of a single save as a one line JSON object, with the same information as a batch record
+// plus the details of each missing collectible
+std::string getJsonRecord(const std::filesystem::path &saveFile, bool success, const Analysis &analysis, const std::unordered_set<CollectibleEnum> &allowedTypes) {
+    std::string out = "{\"path\":";
+    appendJsonString(out, saveFile.string());
+    out += ",\"status\":\"" + getStatus(success, analysis) + "\",\"missing\":";
+    appendJsonCollectibles(out, analysis.missing & getAllowedCollectibles(allowedTypes));
+    out += ",\"butterfly_bug\":";
+    out += analysis.butterflyBug ? "true" : "false";
+    out += ",\"conjuration_bug\":";
+    out += analysis.conjurationBug ? "true" : "false";
+    out += ",\"unreadable_types\":[";
+    bool first = true;
+    for ( const auto &sqlTable : analysis.queryErrors ) {
+        for ( const auto &collectibleType : tables[sqlTable].affected ) {
+            if (!first) out += ",";
+            first = false;
+            appendJsonString(out, collectibleType);
         }
     }
-    if (fs && fs.is_open()) {
-        fs.close();
+    out += "],\"salvaged_types\":[";
+    first = true;
+    for ( const auto &sqlTable : analysis.salvagedQueries ) {
+        for ( const auto &collectibleType : tables[sqlTable].affected ) {
+            if (!first) out += ",";
+            first = false;
+            appendJsonString(out, collectibleType);
+        }
     }
-    return true;
+    out += "],\"errors\":[";
+    first = true;
+    for ( const auto &error : analysis.errors ) {
+        if (!first) out += ",";
+        first = false;
+        appendJsonString(out, error);
+    }
+    out += "]}";
+    return out;
+}
+
+// Gets the result of a single save in the chosen format, as a single line
+std::string getRecord(OutputFormat format, const std::filesystem::path &saveFile, bool success, const Analysis &analysis,
+                      const std::unordered_set<CollectibleEnum> &allowedTypes) {
+    if (format == JsonFormat) return getJsonRecord(saveFile, success, analysis, allowedTypes);
+    return getBatchRecord(saveFile, success, analysis, allowedTypes);
+}
+
+// Analyzes many saves at once, writing one record per save to stream in the order the saves were given
+// Returns whether every save could be read
+bool runBatch(const std::vector<std::filesystem::path> &saves, SaveCache &cache, const AnalysisOptions &options, unsigned int workers,
+              const std::unordered_set<CollectibleEnum> &allowedTypes, OutputFormat format, std::ostream &stream) {
+    if (format == TableFormat) stream << BATCH_HEADER << std::endl;
+    // Records are written as soon as every save before them is done
+    std::vector<std::string> records(saves.size());
+    std::vector<bool> done(saves.size(), false);
+    std::size_t nextRecord = 0;
+    bool allSucceeded = true;
+    std::mutex recordsMutex;
+    runParallel(saves.size(), workers, [&](std::size_t i) {
+        Analysis analysis;
+        bool success = analyzeSave(saves[i], cache, options, analysis);
+        std::string record = getRecord(format, saves[i], success, analysis, allowedTypes);
+        std::lock_guard<std::mutex> lock(recordsMutex);
+        allSucceeded = allSucceeded && success;
+        records[i] = std::move(record);
+        done[i] = true;
+        for (; nextRecord < saves.size() && done[nextRecord]; nextRecord++) {
+            stream << records[nextRecord] << std::endl;
+            records[nextRecord].clear();
+        }
+    });
+    return allSucceeded;
 }
 
 // Returns the absolute path to the output text file, empty if no output
@@ -490,27 +471,385 @@ std::filesystem::path getOutputFile(const std::filesystem::path &exePath, const
     return result;
 }
 
+// Gets how the database should be loaded, returns whether the --db-mode argument was valid
+bool getDBMode(const argparse::ArgumentParser &parsedArgs, DBMode &dbMode) {
+    auto mode = parsedArgs.get<std::string>("--db-mode");
+    if (mode == "image") {
+        dbMode = ImageDB;
+    } else if (mode == "memory") {
+        dbMode = MemoryDB;
+    } else if (mode == "file") {
+        dbMode = FileDB;
+    } else {
+        std::cerr << dye::red("Unknown database mode \"" + mode + "\", must be image, memory or file") << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Gets how results should be written, returns whether the --format argument was valid
+bool getFormat(const argparse::ArgumentParser &parsedArgs, OutputFormat &format) {
+    auto name = parsedArgs.get<std::string>("--format");
+    if (name == "table") {
+        format = TableFormat;
+    } else if (name == "json") {
+        format = JsonFormat;
+    } else {
+        std::cerr << dye::red("Unknown output format \"" + name + "\", must be table or json") << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Gets the collectible types to report without prompting for them, for modes that don't interact with the user
+// Only filters from the command line are used, all collectibles if there aren't any
+std::unordered_set<CollectibleEnum> getArgFilters(const argparse::ArgumentParser &parsedArgs) {
+    std::unordered_set<CollectibleEnum> allowedTypes;
+    parseFilters(parsedArgs.get<std::vector<std::string>>("--filters"), allowedTypes);
+    if (allowedTypes.empty()) {
+        for (int i = 0; i < collectibleTypes.size(); i++) allowedTypes.insert(CollectibleEnum(i));
+    }
+    return allowedTypes;
+}
+
+// Writes a record to stdout, and to outFile if it isn't empty, and returns whether it was successful
+bool writeRecord(const std::string &record, const std::filesystem::path &outFile) {
+    std::cout << record << std::endl;
+    if (!outFile.empty()) {
+        std::ofstream fs(outFile.string(), std::ios::out);
+        if (!fs.is_open()) {
+            std::cerr << dye::red("Legilimens was unable to write to \"" + outFile.string() + "\"") << std::endl;
+            return false;
+        }
+        fs << record << std::endl;
+    }
+    return true;
+}
+
+// Writes the result of a single save as JSON to stdout, and to outFile if it isn't empty, and returns whether it was successful
+bool legilimizeJson(const std::filesystem::path& saveFile, SaveCache &cache, const AnalysisOptions &options, const std::filesystem::path &outFile,
+                    const std::unordered_set<CollectibleEnum> &allowedTypes) {
+    Analysis analysis;
+    bool success = analyzeSave(saveFile, cache, options, analysis);
+    return writeRecord(getJsonRecord(saveFile, success, analysis, allowedTypes), outFile) && success;
+}
+
+// Gets what should read the save's database, returns whether the --reader argument was valid
+bool getReader(const argparse::ArgumentParser &parsedArgs, DBReaderMode &reader) {
+    auto name = parsedArgs.get<std::string>("--reader");
+    if (name == "sqlite") {
+        reader = SqliteReader;
+    } else if (name == "native") {
+        reader = NativeReader;
+    } else if (name == "verify") {
+        reader = VerifyReader;
+    } else {
+        std::cerr << dye::red("Unknown reader \"" + name + "\", must be sqlite, native or verify") << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Runs batch mode, and returns whether every save could be read
+bool runBatchMode(const std::filesystem::path &exePath, const argparse::ArgumentParser &parsedArgs, SaveCache &cache, AnalysisOptions &options,
+                  OutputFormat format) {
+    std::vector<std::filesystem::path> saves = getBatchSaves(parsedArgs.get<std::vector<std::string>>("--batch"));
+    if (saves.empty()) {
+        std::cerr << dye::red("Legilimens didn't find any save files to analyze") << std::endl;
+        return false;
+    }
+    // Saves are analyzed concurrently, except through a temp DB file since they'd all share it
+    unsigned int workers = parsedArgs.present<unsigned int>("--jobs").value_or(defaultWorkerCount());
+    if (options.dbMode == FileDB) {
+        workers = 1;
+        if (!getTempDBFile(exePath, options.dbFile)) return false;
+    }
+    std::unordered_set<CollectibleEnum> allowedTypes = getArgFilters(parsedArgs);
+    // Records go to the output file if one was chosen, otherwise to stdout
+    std::filesystem::path outFile = parsedArgs.is_used("-o") ? getOutputFile(exePath, parsedArgs) : std::filesystem::path();
+    if (outFile.empty()) return runBatch(saves, cache, options, workers, allowedTypes, format, std::cout);
+    std::ofstream fs(outFile.string(), std::ios::out);
+    if (!fs.is_open()) {
+        std::cerr << dye::red("Legilimens was unable to write to \"" + outFile.string() + "\"") << std::endl;
+        return false;
+    }
+    return runBatch(saves, cache, options, workers, allowedTypes, format, fs);
+}
+
+// Answers one server request read from stream, and returns the record to reply with. Sets quit on QUIT or end of input
+std::string serveRequest(std::istream &stream, SaveCache &cache, const AnalysisOptions &options,
+                         const std::unordered_set<CollectibleEnum> &allowedTypes, OutputFormat format, bool &quit) {
+    std::string line;
+    if (!std::getline(stream, line)) {
+        quit = true;
+        return "";
+    }
+    // Clients on Windows may end lines with \r\n
+    if (line.ends_with('\r')) line.pop_back();
+    if (line == "QUIT") {
+        quit = true;
+        return "";
+    }
+    Analysis analysis;
+    if (line.starts_with("PATH ")) {
+        std::filesystem::path saveFile(line.substr(5));
+        bool success = analyzeSave(saveFile, cache, options, analysis);
+        return getRecord(format, saveFile, success, analysis, allowedTypes);
+    }
+    if (line.starts_with("DATA ")) {
+        // Unlike stoull, from_chars rejects negative sizes instead of wrapping them around, and anything after the digits
+        unsigned long long size = 0;
+        std::string_view sizeText = std::string_view(line).substr(5);
+        auto [end, ec] = std::from_chars(sizeText.data(), sizeText.data() + sizeText.length(), size);
+        if (sizeText.empty() || ec != std::errc() || end != sizeText.data() + sizeText.length()) {
+            analysis.errors.push_back("Invalid size \"" + line.substr(5) + "\"");
+            return getRecord(format, "-", false, analysis, allowedTypes);
+        }
+        // The bytes are always consumed so the next request is read from the right place
+        if (size > SERVER_MAX_DATA_SIZE) {
+            stream.ignore(static_cast<std::streamsize>(size));
+            analysis.errors.emplace_back("The save is too large");
+            return getRecord(format, "-", false, analysis, allowedTypes);
+        }
+        std::string saveData(size, '\0');
+        if (!stream.read(saveData.data(), static_cast<std::streamsize>(size))) {
+            quit = true;
+            analysis.errors.emplace_back("The input ended before the whole save was received");
+            return getRecord(format, "-", false, analysis, allowedTypes);
+        }
+        bool success = analyzeSaveData(saveData, options, analysis);
+        return getRecord(format, "-", success, analysis, allowedTypes);
+    }
+    analysis.errors.push_back("Unknown request \"" + line + "\"");
+    return getRecord(format, "-", false, analysis, allowedTypes);
+}
+
+// Runs server mode, answering requests from stdin until it's closed or sent QUIT
+// The process, SQLite and the collectibles stay loaded between requests, so each one only costs the analysis itself
+bool runServerMode(const std::filesystem::path &exePath, const argparse::ArgumentParser &parsedArgs, SaveCache &cache, AnalysisOptions &options,
+                   OutputFormat format) {
+#ifdef _WIN32
+    // Uploaded saves are binary, so stdin can't translate line endings
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    if (options.dbMode == FileDB && !getTempDBFile(exePath, options.dbFile)) return false;
+    std::unordered_set<CollectibleEnum> allowedTypes = getArgFilters(parsedArgs);
+    // The header tells the client which columns to expect, and that the server is ready
+    if (format == TableFormat) std::cout << BATCH_HEADER << std::endl;
+    bool quit = false;
+    while (!quit) {
+        std::string record = serveRequest(std::cin, cache, options, allowedTypes, format, quit);
+        if (!record.empty()) std::cout << record << std::endl;
+    }
+    return true;
+}
+
+// Analyzes the previous and the latest save of a diff at once, and returns whether both could be read
+// Both use the same catalog, query plan and pooled SQLite connections, so the second save only costs reading its own tables
+bool analyzeDiffSaves(const std::array<std::filesystem::path, 2> &saveFiles, SaveCache &cache, const AnalysisOptions &options,
+                      std::array<Analysis, 2> &analyses, std::array<bool, 2> &success) {
+    // Saves going through a temp DB file would share it
+    unsigned int workers = (options.dbMode == FileDB) ? 1 : 2;
+    runParallel(saveFiles.size(), workers, [&](std::size_t i) {
+        success[i] = analyzeSave(saveFiles[i], cache, options, analyses[i]);
+    });
+    return success[0] && success[1];
+}
+
+// Writes what was collected between two saves to stdout and outFile, and returns whether it was successful
+bool legilimizeDiff(const std::array<std::filesystem::path, 2> &saveFiles, SaveCache &cache, const AnalysisOptions &options,
+                    const std::filesystem::path &outFile, const std::vector<std::string> &filters) {
+    std::array<Analysis, 2> analyses;
+    std::array<bool, 2> success = {false, false};
+    bool bothRead = analyzeDiffSaves(saveFiles, cache, options, analyses, success);
+    for (int i = 0; i < saveFiles.size(); i++) {
+        const Analysis &analysis = analyses[i];
+        if (analysis.errors.empty() && analysis.queryErrors.empty() && analysis.salvagedQueries.empty()) continue;
+        std::cerr << dye::red("While reading \"" + saveFiles[i].string() + "\":") << std::endl;
+        printErrors(analysis.errors);
+        if (success[i]) printQueryProblems(analysis);
+    }
+    if (!bothRead) return false;
+    std::unordered_set<CollectibleEnum> allowedTypes;
+    bool sortByType = getFilters(filters, allowedTypes);
+    CollectibleSet allowed = getAllowedCollectibles(allowedTypes);
+    SaveDiff diff = diffSaves(analyses[0], analyses[1]);
+    CollectibleSet collected = diff.collected & allowed;
+    CollectibleSet lost = diff.lost & allowed;
+    // Rendered once and written to the console and the output file, like legilimize
+    Output output;
+    output.addSink(std::cout, enableConsoleColors());
+    std::ofstream fs;
+    if (!outFile.empty()) {
+        fs = std::ofstream(outFile.string(), std::ios::out);
+        if (fs.is_open()) {
+            printTitle(fs);
+            output.addSink(fs, false);
+        }
+    }
+    std::ostream &out = output.stream();
+    out << std::endl << "Previous save: " << saveFiles[0].string() << std::endl << "Latest save:   " << saveFiles[1].string() << std::endl;
+    out << std::endl << collected.count() << " collected since the previous save, " << (analyses[1].missing & allowed).count() << " still missing" << std::endl;
+    if (collected.none() && lost.none()) {
+        out << std::endl << "Nothing was collected between these saves." << std::endl;
+    }
+    if (collected.any()) {
+        out << std::endl << termcolor::green << "Collected since the previous save:" << termcolor::reset << std::endl;
+        writeMissingTables(out, collected, sortByType);
+    }
+    if (lost.any()) {
+        out << std::endl << termcolor::red << "Collected in the previous save, but missing in the latest one. Were the saves given the wrong way around?" << termcolor::reset << std::endl;
+        writeMissingTables(out, lost, sortByType);
+    }
+    {
+        ProfileSpan span("output", "flush");
+        output.flush();
+    }
+    return true;
+}
+
+// Gets what was collected between two saves as a one line JSON object, with the details of each collectible like getJsonRecord
+std::string getJsonDiffRecord(const std::array<std::filesystem::path, 2> &saveFiles, const std::array<bool, 2> &success,
+                              const std::array<Analysis, 2> &analyses, const std::unordered_set<CollectibleEnum> &allowedTypes) {
+    // The worst status of the two saves
+    std::string status = getStatus(success[0], analyses[0]);
+    std::string latestStatus = getStatus(success[1], analyses[1]);
+    if (status == "ok" || latestStatus == "error") status = latestStatus;
+    CollectibleSet allowed = getAllowedCollectibles(allowedTypes);
+    SaveDiff diff = diffSaves(analyses[0], analyses[1]);
+    std::string out = "{\"previous\":";
+    appendJsonString(out, saveFiles[0].string());
+    out += ",\"latest\":";
+    appendJsonString(out, saveFiles[1].string());
+    out += ",\"status\":\"" + status + "\",\"collected\":";
+    appendJsonCollectibles(out, success[0] && success[1] ? diff.collected & allowed : CollectibleSet());
+    out += ",\"lost\":";
+    appendJsonCollectibles(out, success[0] && success[1] ? diff.lost & allowed : CollectibleSet());
+    out += ",\"still_missing\":" + std::to_string(success[1] ? (analyses[1].missing & allowed).count() : 0);
+    // Errors are prefixed with the save they're about
+    out += ",\"errors\":[";
+    bool first = true;
+    for (int i = 0; i < saveFiles.size(); i++) {
+        std::vector<std::string> errors = analyses[i].errors;
+        for ( const auto &sqlTable : analyses[i].queryErrors ) {
+            for ( const auto &collectibleType : tables[sqlTable].affected ) errors.push_back("Unable to read " + std::string(collectibleType));
+        }
+        for ( const auto &error : errors ) {
+            if (!first) out += ",";
+            first = false;
+            appendJsonString(out, saveFiles[i].string() + ": " + error);
+        }
+    }
+    out += "]}";
+    return out;
+}
+
+// Runs diff mode, comparing the two saves given with --diff, or the two latest saves of a character if none were given
+bool runDiffMode(const std::filesystem::path &exePath, const argparse::ArgumentParser &parsedArgs, SaveCache &cache, AnalysisOptions &options,
+                 OutputFormat format) {
+    auto args = parsedArgs.get<std::vector<std::string>>("--diff");
+    std::array<std::filesystem::path, 2> saveFiles;
+    if (args.size() == 2) {
+        saveFiles = {args[0], args[1]};
+    } else if (!args.empty()) {
+        std::cerr << dye::red("--diff takes the previous save and then the latest one, or nothing to compare a character's two latest saves") << std::endl;
+        return false;
+    } else if (format == JsonFormat) {
+        // JSON is for other programs, so nothing is prompted for
+        std::cerr << dye::red("Two save files are required with --diff and --format json") << std::endl;
+        return false;
+    } else if (!getLatestSaves(cache, saveFiles[0], saveFiles[1])) {
+        return false;
+    }
+    if (options.dbMode == FileDB && !getTempDBFile(exePath, options.dbFile)) return false;
+    if (format == JsonFormat) {
+        std::filesystem::path outFile = parsedArgs.is_used("-o") ? getOutputFile(exePath, parsedArgs) : std::filesystem::path();
+        std::array<Analysis, 2> analyses;
+        std::array<bool, 2> success = {false, false};
+        bool bothRead = analyzeDiffSaves(saveFiles, cache, options, analyses, success);
+        return writeRecord(getJsonDiffRecord(saveFiles, success, analyses, getArgFilters(parsedArgs)), outFile) && bothRead;
+    }
+    return legilimizeDiff(saveFiles, cache, options, getOutputFile(exePath, parsedArgs), parsedArgs.get<std::vector<std::string>>("--filters"));
+}
+
 // Runs the program, except the final "Press enter to close", and returns whether it succeeds
 bool run(const std::filesystem::path &exePath, const argparse::ArgumentParser &parsedArgs) {
-    printTitle(std::cout);
+    bool batch = parsedArgs.is_used("--batch");
+    bool server = parsedArgs.get<bool>("--server");
+    OutputFormat format;
+    if (!getFormat(parsedArgs, format)) return false;
+    if (parsedArgs.is_used("--diff") && (batch || server)) {
+        std::cerr << dye::red("--diff can't be used with --batch or --server") << std::endl;
+        return false;
+    }
+    if (!batch && !server && format == TableFormat) printTitle(std::cout);
+    // Load the metadata of previously seen saves
+    SaveCache cache(exePath.parent_path() / SAVE_CACHE_FILE);
+    cache.load();
+    AnalysisOptions options;
+    if (!getDBMode(parsedArgs, options.dbMode) || !getReader(parsedArgs, options.reader)) return false;
+    options.queryWorkers = parsedArgs.get<unsigned int>("--query-jobs");
+    options.salvage = parsedArgs.get<bool>("--salvage");
+    if (batch) return runBatchMode(exePath, parsedArgs, cache, options, format);
+    if (server) return runServerMode(exePath, parsedArgs, cache, options, format);
+    if (parsedArgs.is_used("--diff")) return runDiffMode(exePath, parsedArgs, cache, options, format);
     // Get save path
     std::filesystem::path saveFile(parsedArgs.get<std::string>("file"));
-    if (saveFile.empty()) saveFile = getSavePath();
-    // Get temp DB file
-    std::filesystem::path dbFile;
-    if (!getTempDBFile(exePath, dbFile)) return false;
+    if (format == JsonFormat) {
+        // JSON is for other programs, so nothing is prompted for
+        if (saveFile.empty()) {
+            std::cerr << dye::red("A save file is required with --format json") << std::endl;
+            return false;
+        }
+        if (options.dbMode == FileDB && !getTempDBFile(exePath, options.dbFile)) return false;
+        std::filesystem::path outFile = parsedArgs.is_used("-o") ? getOutputFile(exePath, parsedArgs) : std::filesystem::path();
+        return legilimizeJson(saveFile, cache, options, outFile, getArgFilters(parsedArgs));
+    }
+    if (saveFile.empty()) saveFile = getSavePath(cache);
+    // Get temp DB file, only if the database shouldn't be read in memory
+    if (options.dbMode == FileDB && !getTempDBFile(exePath, options.dbFile)) return false;
     // Get output file
     std::filesystem::path outFile = getOutputFile(exePath, parsedArgs);
     // Run
-    return legilimize(saveFile, dbFile, outFile, parsedArgs.get<std::vector<std::string>>("--filters"));
+    return legilimize(saveFile, cache, options, outFile, parsedArgs.get<std::vector<std::string>>("--filters"));
+}
+
+// Writes the Chrome trace of --trace-file, and returns whether it was successful
+// A save is never overwritten, in case its path was given as the trace file by mistake
+bool writeTraceFile(const std::filesystem::path &traceFile) {
+    bool isSave = false;
+    if (std::filesystem::exists(traceFile)) {
+        SaveFile existing;
+        isSave = existing.open(traceFile, sizeof(MAGIC_HEADER) - 1) && existing.data() == MAGIC_HEADER;
+    }
+    if (isSave) {
+        std::cerr << dye::red("\"" + traceFile.string() + "\" is a save file, so the trace wasn't written to it") << std::endl;
+        return false;
+    }
+    if (!writeChromeTrace(traceFile)) {
+        std::cerr << dye::red("Legilimens was unable to write the trace to \"" + traceFile.string() + "\"") << std::endl;
+        return false;
+    }
+    return true;
 }
 
 int main(int argc, char *argv[]) {
+    // Tables write their colors as escape sequences, see Output
+    enableConsoleColors();
     bool success;
     argparse::ArgumentParser parsedArgs = parseArgs(argc, argv, success);
     if (!success) return 1;
+    bool profile = parsedArgs.get<bool>("--profile") || parsedArgs.is_used("--trace-file");
+    if (profile) enableProfiling();
     success = run(std::filesystem::path(argv[0]), parsedArgs);
-    if (!parsedArgs.get<bool>("--dont-confirm-exit")) {
+    // The profile goes to stderr so it doesn't mix with records in stdout
+    if (profile) {
+        writeProfileSummary(std::cerr);
+        if (parsedArgs.is_used("--trace-file") && !writeTraceFile(parsedArgs.get<std::string>("--trace-file"))) success = false;
+    }
+    // Only people running a single save in a table need the window to stay open
+    bool interactive = !parsedArgs.is_used("--batch") && !parsedArgs.get<bool>("--server") && parsedArgs.get<std::string>("--format") == DEFAULT_FORMAT;
+    if (!parsedArgs.get<bool>("--dont-confirm-exit") && interactive) {
         std::cout << std::endl << "Press enter to close this window...";
         getchar();
     }
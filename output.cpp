@@ -0,0 +1,90 @@
+#include "output.h"
+#include <cstdio>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include "tabulate.hpp"
+
+Output::Output() {
+    buffer << termcolor::colorize;
+}
+
+void Output::addSink(std::ostream &stream, bool colors) {
+    sinks.push_back({&stream, colors});
+}
+
+void Output::flush() {
+    std::string text = buffer.str();
+    buffer.str("");
+    if (text.empty()) return;
+    // Only strip the colors once, however many sinks don't show them
+    std::string plain;
+    bool stripped = false;
+    for ( const auto &sink : sinks ) {
+        if (sink.colors) {
+            *sink.stream << text;
+        } else {
+            if (!stripped) {
+                plain = stripColors(text);
+                stripped = true;
+            }
+            *sink.stream << plain;
+        }
+        sink.stream->flush();
+    }
+}
+
+std::string stripColors(std::string_view text) {
+    std::string result;
+    result.reserve(text.length());
+    std::size_t pos = 0;
+    while (pos < text.length()) {
+        std::size_t escape = text.find('\033', pos);
+        if (escape == std::string_view::npos) escape = text.length();
+        result.append(text, pos, escape - pos);
+        if (escape == text.length()) break;
+        // A control sequence is ESC [, parameter and intermediate bytes, then a final byte from @ to ~
+        pos = escape + 1;
+        if (pos < text.length() && text[pos] == '[') {
+            pos++;
+            while (pos < text.length() && !(text[pos] >= '@' && text[pos] <= '~')) pos++;
+            if (pos < text.length()) pos++;
+        }
+    }
+    return result;
+}
+
+bool enableConsoleColors() {
+    static const bool enabled = [] {
+#ifdef _WIN32
+        // Windows 10 consoles understand escape sequences, but only once they're told to
+        HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD mode;
+        if (console == INVALID_HANDLE_VALUE || !GetConsoleMode(console, &mode)) return false;
+        return (mode & ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0 || SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0;
+#else
+        return isatty(fileno(stdout)) != 0;
+#endif
+    }();
+    return enabled;
+}
+
+void appendJsonString(std::string &out, std::string_view value) {
+    static const char hexDigits[] = "0123456789abcdef";
+    out += '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out += "\\u00";
+            out += hexDigits[c >> 4];
+            out += hexDigits[c & 0xF];
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
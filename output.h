@@ -0,0 +1,40 @@
+#ifndef LEGILIMENS_HOGWARTS_LEGACY_CPP_OUTPUT_H
+#define LEGILIMENS_HOGWARTS_LEGACY_CPP_OUTPUT_H
+
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Output that's rendered once and then written to every sink, e.g. the console and the -o file
+// Colors are rendered as ANSI escape sequences, which are stripped for sinks that don't show colors
+class Output {
+public:
+    Output();
+
+    // Adds a stream to write the output to. Colors are only written to it if colors is true
+    void addSink(std::ostream &stream, bool colors);
+    // The stream to render into. It's marked with termcolor::colorize, so tables and termcolor manipulators always write their colors
+    std::ostream &stream() { return buffer; }
+    // Writes everything rendered since the last flush to every sink
+    void flush();
+
+private:
+    struct Sink {
+        std::ostream *stream;
+        bool colors;
+    };
+
+    std::ostringstream buffer;
+    std::vector<Sink> sinks;
+};
+
+// Removes ANSI escape sequences from text
+std::string stripColors(std::string_view text);
+// Appends value to out as a JSON string
+void appendJsonString(std::string &out, std::string_view value);
+// Lets the console show colors written as escape sequences, and returns whether stdout is a console that shows them
+bool enableConsoleColors();
+
+#endif //LEGILIMENS_HOGWARTS_LEGACY_CPP_OUTPUT_H
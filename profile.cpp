@@ -0,0 +1,124 @@
+#include "profile.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "output.h"
+
+namespace {
+    // A span that has ended. Times are in nanoseconds since profiling was enabled
+    struct ProfileEvent {
+        std::string category, name, detail;
+        long long start, duration;
+        unsigned int thread;
+    };
+
+    std::chrono::steady_clock::time_point profileStart;
+    std::mutex eventsMutex;
+    std::vector<ProfileEvent> events;
+    std::atomic<unsigned int> nextThread = 1;
+
+    // Numbers threads in the order they first end a span, which is easier to read in a trace than their native ids
+    unsigned int getThreadNumber() {
+        thread_local unsigned int number = nextThread++;
+        return number;
+    }
+
+    long long sinceStart(std::chrono::steady_clock::time_point time) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time - profileStart).count();
+    }
+
+    double toMilliseconds(long long nanoseconds) {
+        return static_cast<double>(nanoseconds) / 1e6;
+    }
+
+    // Writes nanoseconds in microseconds, the unit of trace events
+    void writeMicroseconds(std::ostream &stream, long long nanoseconds) {
+        stream << nanoseconds / 1000 << '.' << std::setw(3) << std::setfill('0') << nanoseconds % 1000 << std::setfill(' ');
+    }
+}
+
+void enableProfiling() {
+    profileStart = std::chrono::steady_clock::now();
+    profiling = true;
+}
+
+void ProfileSpan::begin(std::string_view spanCategory, std::string_view spanName, std::string_view spanDetail) {
+    active = true;
+    category = spanCategory;
+    name = spanName;
+    detail = spanDetail;
+    start = std::chrono::steady_clock::now();
+}
+
+void ProfileSpan::end() {
+    auto now = std::chrono::steady_clock::now();
+    ProfileEvent event = {std::move(category), std::move(name), std::move(detail), sinceStart(start), sinceStart(now) - sinceStart(start), getThreadNumber()};
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    events.push_back(std::move(event));
+}
+
+void writeProfileSummary(std::ostream &stream) {
+    struct Stage {
+        unsigned long calls = 0;
+        long long total = 0;
+        long long longest = 0;
+    };
+    std::map<std::pair<std::string_view, std::string_view>, Stage> stages;
+    long long wall = sinceStart(std::chrono::steady_clock::now());
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    for ( const auto &event : events ) {
+        Stage &stage = stages[{event.category, event.name}];
+        stage.calls++;
+        stage.total += event.duration;
+        stage.longest = std::max(stage.longest, event.duration);
+    }
+    std::vector<std::pair<std::string, Stage>> sorted;
+    std::size_t nameWidth = 5;
+    for ( const auto &[key, stage] : stages ) {
+        sorted.emplace_back(std::string(key.first) + ": " + std::string(key.second), stage);
+        nameWidth = std::max(nameWidth, sorted.back().first.length());
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) { return a.second.total > b.second.total; });
+    // Spans on different threads overlap, so the totals can add up to more than the time taken
+    stream << std::endl << "Profile, " << std::fixed << std::setprecision(3) << toMilliseconds(wall) << " ms in total:" << std::endl;
+    stream << std::left << std::setw(static_cast<int>(nameWidth)) << "Stage" << std::right << std::setw(8) << "Calls" << std::setw(14) << "Total ms"
+           << std::setw(12) << "Mean ms" << std::setw(12) << "Max ms" << std::endl;
+    for ( const auto &[name, stage] : sorted ) {
+        stream << std::left << std::setw(static_cast<int>(nameWidth)) << name << std::right << std::setw(8) << stage.calls
+               << std::setw(14) << toMilliseconds(stage.total) << std::setw(12) << toMilliseconds(stage.total) / static_cast<double>(stage.calls)
+               << std::setw(12) << toMilliseconds(stage.longest) << std::endl;
+    }
+    stream << std::defaultfloat;
+}
+
+bool writeChromeTrace(const std::filesystem::path &traceFile) {
+    std::ofstream fs(traceFile.string(), std::ios::out);
+    if (!fs.is_open()) return false;
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    // Complete ("X") events, which each have their own start and duration
+    std::string text;
+    fs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (std::size_t i = 0; i < events.size(); i++) {
+        const ProfileEvent &event = events[i];
+        text = i == 0 ? "\n{\"name\":" : ",\n{\"name\":";
+        appendJsonString(text, event.name);
+        text += ",\"cat\":";
+        appendJsonString(text, event.category);
+        text += ",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(event.thread);
+        if (!event.detail.empty()) {
+            text += ",\"args\":{\"detail\":";
+            appendJsonString(text, event.detail);
+            text += "}";
+        }
+        fs << text << ",\"ts\":";
+        writeMicroseconds(fs, event.start);
+        fs << ",\"dur\":";
+        writeMicroseconds(fs, event.duration);
+        fs << "}";
+    }
+    fs << "\n]}" << std::endl;
+    return fs.good();
+}
@@ -0,0 +1,53 @@
+#ifndef LEGILIMENS_HOGWARTS_LEGACY_CPP_PROFILE_H
+#define LEGILIMENS_HOGWARTS_LEGACY_CPP_PROFILE_H
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Lightweight tracing of how long each stage of analyzing a save takes, enabled with --profile
+// Stages are timed by ProfileSpans. While profiling is off they only check whether it's on, so they can stay in hot paths
+
+// Whether spans are recorded. Only set by enableProfiling, before any span starts
+inline std::atomic<bool> profiling = false;
+
+// Starts recording spans. Timestamps are relative to when this is called
+void enableProfiling();
+
+// Times the scope it lives in, as a span named name in category, e.g. ("sqlite", "MapLocationDataDynamic")
+// Spans with the same category and name are added up in the summary. detail is only kept for the trace, e.g. the save's path
+class ProfileSpan {
+public:
+    ProfileSpan(std::string_view category, std::string_view name, std::string_view detail = {}) {
+        if (profiling.load(std::memory_order_relaxed)) begin(category, name, detail);
+    }
+    // A file as the detail, which is only converted to text while profiling
+    ProfileSpan(std::string_view category, std::string_view name, const std::filesystem::path &file) {
+        if (profiling.load(std::memory_order_relaxed)) begin(category, name, file.string());
+    }
+    ProfileSpan(const ProfileSpan &) = delete;
+    ProfileSpan &operator=(const ProfileSpan &) = delete;
+
+    ~ProfileSpan() {
+        if (active) end();
+    }
+
+private:
+    bool active = false;
+    std::string category, name, detail;
+    std::chrono::steady_clock::time_point start;
+
+    void begin(std::string_view spanCategory, std::string_view spanName, std::string_view spanDetail);
+    void end();
+};
+
+// Writes the number of calls, total, mean and longest time of every span, longest total first
+void writeProfileSummary(std::ostream &stream);
+// Writes every span as Chrome trace event JSON, which chrome://tracing and https://ui.perfetto.dev can show as a timeline
+// Returns whether it was successful
+bool writeChromeTrace(const std::filesystem::path &traceFile);
+
+#endif //LEGILIMENS_HOGWARTS_LEGACY_CPP_PROFILE_H
@@ -0,0 +1,93 @@
+#include "report.h"
+#include "getsave.h"
+#include "profile.h"
+#include "resulttable.h"
+
+namespace {
+    // Gets the color of a collectible's row
+    const char *getRowColor(const CollectibleType &type) {
+        if (type.timestampName == "Field guide page") return ANSI_CYAN;
+        if (type.timestampName == "Demiguise Moon") return ANSI_BLUE;
+        if (type.timestampName == "Merlin Trial") return ANSI_GREEN;
+        if (type.timestampName == "Butterfly Chest") return ANSI_YELLOW;
+        if (type.timestampName == "Collection Chest") return ANSI_MAGENTA;
+        return ANSI_WHITE;
+    }
+
+    // Writes the header and table for a region
+    void writeRegionTable(std::ostream &stream, RegionEnum region, const CollectibleSet &missingInRegion) {
+        const RegionStruct &regionInfo = regions[region];
+        ProfileSpan span("render", "region table", regionInfo.name);
+        stream << "\n\n";
+        if (regionInfo.globalRegion.empty()) {
+            writeTableHeader(stream, regionInfo.name, TABLE_WIDTH);
+        } else {
+            writeTableHeader(stream, std::string(regionInfo.globalRegion) + " - " + std::string(regionInfo.name), TABLE_WIDTH);
+        }
+        stream << '\n';
+        ResultTable table(stream, {{27}, {TABLE_WIDTH - 64 - 2, true}, {37}});
+        table.addRow({"Item", "Type", "Location"});
+        std::string name, video;
+        for (int i = 0; i < collectibles.size(); i++) {
+            if (!missingInRegion.test(i)) continue;
+            const CollectibleStruct &collectible = collectibles[i];
+            const CollectibleType &type = collectibleTypes[collectible.type];
+            name = collectible.index;
+            if (collectible.type != FinishingTouchEnemy) name = std::string(type.timestampName) + " #" + name;
+            video = getVideoUrl(collectible);
+            if (video.empty()) video = "No video yet";
+            table.addRow({name, type.timeStampParen, video}, getRowColor(type));
+        }
+        table.finish();
+        stream << '\n';
+    }
+
+    // Writes the header and table for a collectible type
+    void writeTypeTable(std::ostream &stream, CollectibleEnum type, const CollectibleSet &missingOfType) {
+        const CollectibleType &collectibleInfo = collectibleTypes[type];
+        ProfileSpan span("render", "type table", collectibleInfo.name);
+        stream << "\n\n";
+        if (!collectibleInfo.sortByTypeName.empty()) {
+            writeTableHeader(stream, collectibleInfo.sortByTypeName, TABLE_WIDTH);
+        } else if (collectibleInfo.timeStampParen.empty()) {
+            writeTableHeader(stream, collectibleInfo.timestampName, TABLE_WIDTH);
+        } else {
+            writeTableHeader(stream, std::string(collectibleInfo.timestampName) + " - " + std::string(collectibleInfo.timeStampParen), TABLE_WIDTH);
+        }
+        stream << '\n';
+        ResultTable table(stream, {{TABLE_WIDTH - 37 - 1}, {37, true}});
+        table.addRow({"Item", "Location"});
+        const char *color = getRowColor(collectibleInfo);
+        std::string name, video;
+        for (int i = 0; i < collectibles.size(); i++) {
+            if (!missingOfType.test(i)) continue;
+            const CollectibleStruct &collectible = collectibles[i];
+            name = collectible.index;
+            if (collectible.type != FinishingTouchEnemy) name = std::string(regions[collectible.region].name) + " #" + name;
+            video = getVideoUrl(collectible);
+            if (video.empty()) video = "No video yet";
+            table.addRow({name, video}, color);
+        }
+        table.finish();
+        stream << '\n';
+    }
+}
+
+std::string getVideoUrl(const CollectibleStruct& collectible) {
+    if (collectible.video == UINT8_MAX) return "";
+    return "https://youtu.be/" + std::string(videoIds[collectible.video]) + "&t=" + std::to_string(collectible.timestamp);
+}
+
+void writeMissingTables(std::ostream &stream, const CollectibleSet &shown, bool sortByType) {
+    if (sortByType) {
+        for (int type = 0; type < collectibleTypes.size(); type++) {
+            CollectibleSet missingOfType = shown & getTypeMask(CollectibleEnum(type));
+            if (missingOfType.any()) writeTypeTable(stream, CollectibleEnum(type), missingOfType);
+        }
+    } else {
+        for (int region = 0; region < regions.size(); region++) {
+            CollectibleSet missingInRegion = shown & getRegionMask(RegionEnum(region));
+            if (missingInRegion.any()) writeRegionTable(stream, RegionEnum(region), missingInRegion);
+        }
+    }
+}
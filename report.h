@@ -0,0 +1,13 @@
+#ifndef LEGILIMENS_HOGWARTS_LEGACY_CPP_REPORT_H
+#define LEGILIMENS_HOGWARTS_LEGACY_CPP_REPORT_H
+
+#include <ostream>
+#include <string>
+#include "collectibles.h"
+
+// Gets the link to a collectible's video at its timestamp, empty if there is no video yet
+std::string getVideoUrl(const CollectibleStruct& collectible);
+// Writes a table of the shown collectibles for each type, or each region if sortByType is false, with colors as escape sequences
+void writeMissingTables(std::ostream &stream, const CollectibleSet &shown, bool sortByType);
+
+#endif //LEGILIMENS_HOGWARTS_LEGACY_CPP_REPORT_H
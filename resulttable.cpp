@@ -0,0 +1,147 @@
+#include "resulttable.h"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+    void writeSpaces(std::ostream &stream, std::size_t count) {
+        static const std::string spaces(128, ' ');
+        while (count > 0) {
+            std::size_t length = std::min(count, spaces.length());
+            stream.write(spaces.data(), static_cast<std::streamsize>(length));
+            count -= length;
+        }
+    }
+
+    bool isSpace(char c) {
+        return std::isspace(static_cast<unsigned char>(c)) != 0;
+    }
+
+    std::string_view trim(std::string_view text) {
+        while (!text.empty() && isSpace(text.front())) text.remove_prefix(1);
+        while (!text.empty() && isSpace(text.back())) text.remove_suffix(1);
+        return text;
+    }
+
+    // Splits text into the lines tabulate would print it on, in a column with room for width characters
+    // Text that fits, which is nearly all of it, is returned as is. Anything else goes through tabulate's
+    // word wrapping: words are split after spaces, tabs and dashes, and words longer than a line are hyphenated
+    void splitLines(std::string_view text, std::size_t width, std::vector<std::string> &wrapped, std::vector<std::string_view> &lines) {
+        lines.clear();
+        if (text.find('\n') == std::string_view::npos) {
+            if (text.length() <= width) {
+                if (!text.empty()) lines.push_back(trim(text));
+                return;
+            }
+            std::string result;
+            std::size_t lineLength = 0;
+            auto addWord = [&](std::string word) {
+                if (lineLength + word.length() > width) {
+                    if (lineLength > 0) {
+                        result += '\n';
+                        lineLength = 0;
+                    }
+                    while (word.length() > width) {
+                        result += word.substr(0, width - 1) + "-\n";
+                        word.erase(0, width - 1);
+                    }
+                    std::size_t start = 0;
+                    while (start < word.length() && isSpace(word[start])) start++;
+                    word.erase(0, start);
+                }
+                result += word;
+                lineLength += word.length();
+            };
+            std::size_t start = 0;
+            while (true) {
+                std::size_t index = text.find_first_of(" -\t", start);
+                if (index == std::string_view::npos) {
+                    addWord(std::string(text.substr(start)));
+                    break;
+                }
+                // Spaces are words of their own, while dashes stick to the word before them
+                if (isSpace(text[index])) {
+                    addWord(std::string(text.substr(start, index - start)));
+                    addWord(std::string(1, text[index]));
+                } else {
+                    addWord(std::string(text.substr(start, index - start + 1)));
+                }
+                start = index + 1;
+            }
+            wrapped.push_back(std::move(result));
+            text = wrapped.back();
+        }
+        // Lines are split on newlines, and a trailing empty line is dropped
+        std::size_t pos;
+        while ((pos = text.find('\n')) != std::string_view::npos) {
+            lines.push_back(trim(text.substr(0, pos)));
+            text.remove_prefix(pos + 1);
+        }
+        if (!text.empty()) lines.push_back(trim(text));
+    }
+
+    // Writes a line of a cell, padded to the width of its column
+    void writeCellLine(std::ostream &stream, std::string_view line, const ResultColumn &column) {
+        std::size_t spaces = column.width > line.length() + 2 ? column.width - line.length() - 2 : 0;
+        std::size_t before = column.centered ? spaces / 2 + spaces % 2 : 0;
+        writeSpaces(stream, 1 + before);
+        stream << line;
+        writeSpaces(stream, spaces - before + 1);
+    }
+}
+
+ResultTable::ResultTable(std::ostream &stream, std::vector<ResultColumn> columns) : stream(stream), columns(std::move(columns)), lines(this->columns.size()) {
+    border = "+";
+    for ( const auto &column : this->columns ) {
+        border.append(column.width, '-');
+        border += '+';
+    }
+    border += '\n';
+    // Lines point into the wrapped text, so it mustn't reallocate while a row is written
+    wrapped.reserve(this->columns.size());
+}
+
+void ResultTable::addRow(std::initializer_list<std::string_view> cells, const char *color) {
+    wrapped.clear();
+    std::size_t height = 0;
+    std::size_t column = 0;
+    for ( const auto &cell : cells ) {
+        if (column == columns.size()) break;
+        splitLines(cell, columns[column].width > 2 ? columns[column].width - 2 : columns[column].width, wrapped, lines[column]);
+        height = std::max(height, lines[column].size());
+        column++;
+    }
+    for (; column < columns.size(); column++) lines[column].clear();
+    stream << border;
+    for (std::size_t k = 0; k < height; k++) {
+        for (column = 0; column < columns.size(); column++) {
+            stream << '|';
+            if (color) stream << color;
+            if (k < lines[column].size()) {
+                writeCellLine(stream, lines[column][k], columns[column]);
+            } else {
+                writeSpaces(stream, columns[column].width);
+            }
+            if (color) stream << ANSI_RESET;
+        }
+        stream << '|';
+        if (k + 1 < height) stream << '\n';
+    }
+    stream << '\n';
+}
+
+void ResultTable::finish() {
+    stream.write(border.data(), static_cast<std::streamsize>(border.length() - 1));
+}
+
+void writeTableHeader(std::ostream &stream, std::string_view text, std::size_t width) {
+    std::vector<std::string> wrapped;
+    wrapped.reserve(1);
+    std::vector<std::string_view> lines;
+    splitLines(text, width > 2 ? width - 2 : width, wrapped, lines);
+    ResultColumn column{width, true};
+    for (std::size_t k = 0; k < lines.size(); k++) {
+        writeCellLine(stream, lines[k], column);
+        if (k + 1 < lines.size()) stream << '\n';
+    }
+    stream << '\n';
+}
@@ -0,0 +1,50 @@
+#ifndef LEGILIMENS_HOGWARTS_LEGACY_CPP_RESULTTABLE_H
+#define LEGILIMENS_HOGWARTS_LEGACY_CPP_RESULTTABLE_H
+
+#include <initializer_list>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Colors for ResultTable rows, as ANSI escape sequences
+#define ANSI_RESET "\033[00m"
+#define ANSI_BLUE "\033[34m"
+#define ANSI_GREEN "\033[32m"
+#define ANSI_YELLOW "\033[33m"
+#define ANSI_MAGENTA "\033[35m"
+#define ANSI_CYAN "\033[36m"
+#define ANSI_WHITE "\033[37m"
+
+// A column of a ResultTable
+struct ResultColumn {
+    std::size_t width; // Including one space of padding on either side, like tabulate's column widths
+    bool centered = false;
+};
+
+// Writes a table with fixed column widths straight to a stream, a row at a time, laid out exactly like tabulate
+// lays out a table with its default borders and padding. Only what the result tables need is supported,
+// i.e. left or centered columns and a color per row, so nothing has to be formatted cell by cell
+// Text too long for its column is word wrapped onto more lines the same way tabulate does it
+class ResultTable {
+public:
+    ResultTable(std::ostream &stream, std::vector<ResultColumn> columns);
+
+    // Writes a row with a cell for each column. color is an escape sequence, nullptr to leave the row uncolored
+    void addRow(std::initializer_list<std::string_view> cells, const char *color = nullptr);
+    // Writes the bottom border, without a newline after it like tabulate
+    void finish();
+
+private:
+    std::ostream &stream;
+    std::vector<ResultColumn> columns;
+    std::string border; // The line between rows, with its newline
+    // Lines of each cell of the row being written, and any text that had to be word wrapped for them. Kept to reuse their memory
+    std::vector<std::vector<std::string_view>> lines;
+    std::vector<std::string> wrapped;
+};
+
+// Writes text centered in a borderless table of the given width, like a tabulate table with hide_border
+void writeTableHeader(std::ostream &stream, std::string_view text, std::size_t width);
+
+#endif //LEGILIMENS_HOGWARTS_LEGACY_CPP_RESULTTABLE_H
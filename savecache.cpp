@@ -0,0 +1,136 @@
+#include "savecache.h"
+#include <fstream>
+#include "getsave.h"
+#include "savefile.h"
+
+namespace {
+    // Key of a save in the cache
+    std::string cacheKey(const std::filesystem::path &savePath) {
+        std::error_code ec;
+        std::filesystem::path absolutePath = std::filesystem::absolute(savePath, ec);
+        return (ec ? savePath : absolutePath).lexically_normal().string();
+    }
+
+    long long timeToTicks(std::filesystem::file_time_type time) {
+        return static_cast<long long>(time.time_since_epoch().count());
+    }
+
+    // Reads values in order out of the cache file, failing instead of reading past its end
+    struct CacheReader {
+        std::string_view bytes;
+        unsigned long long pos;
+
+        bool u64(unsigned long long &result) {
+            if (bytes.length() - pos < 8) return false;
+            result = readU32(bytes, pos) | (unsigned long long) readU32(bytes, pos + 4) << 32;
+            pos += 8;
+            return true;
+        }
+
+        bool str(std::string &result) {
+            unsigned long long length;
+            if (!u64(length) || length > bytes.length() - pos) return false;
+            result = bytes.substr(pos, length);
+            pos += length;
+            return true;
+        }
+    };
+
+    void writeU64(std::ofstream &fs, unsigned long long value) {
+        char bytes[8];
+        for (int i = 0; i < 8; i++) bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+        fs.write(bytes, 8);
+    }
+
+    void writeStr(std::ofstream &fs, const std::string &value) {
+        writeU64(fs, value.length());
+        fs.write(value.data(), static_cast<std::streamsize>(value.length()));
+    }
+}
+
+bool SaveCache::load() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    dirty = false;
+    SaveFile cacheFile;
+    if (file.empty() || !std::filesystem::exists(file) || !cacheFile.open(file)) return false;
+    std::string_view bytes = cacheFile.data();
+    if (!bytes.starts_with(SAVE_CACHE_MAGIC)) return false;
+    CacheReader reader = {bytes, sizeof(SAVE_CACHE_MAGIC) - 1};
+    unsigned long long version, count;
+    if (!reader.u64(version) || version != SAVE_CACHE_VERSION || !reader.u64(count)) return false;
+    std::string key;
+    for (unsigned long long i = 0; i < count; i++) {
+        Entry entry = {0, 0, {}, false};
+        unsigned long long size, time;
+        if (!reader.str(key) || !reader.u64(size) || !reader.u64(time) || !reader.str(entry.info.charName) ||
+            !reader.str(entry.info.charHouse) || !reader.str(entry.info.saveType) || !reader.u64(entry.info.dbOffset) ||
+            !reader.u64(entry.info.dbSize)) {
+            entries.clear();
+            return false;
+        }
+        entry.size = size;
+        entry.time = static_cast<long long>(time);
+        entries[key] = entry;
+    }
+    return true;
+}
+
+bool SaveCache::write() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file.empty()) return false;
+    // Forget saves that no longer exist
+    for (auto it = entries.begin(); it != entries.end(); ) {
+        if (it->second.used) {
+            it++;
+        } else {
+            it = entries.erase(it);
+            dirty = true;
+        }
+    }
+    if (!dirty) return true;
+    // Write to a temporary file first, so a crash can't leave a half written cache
+    std::filesystem::path tempFile = file;
+    tempFile += ".tmp";
+    std::ofstream fs(tempFile, std::ios::out|std::ios::binary|std::ios::trunc);
+    if (!fs.is_open()) return false;
+    fs.write(SAVE_CACHE_MAGIC, sizeof(SAVE_CACHE_MAGIC) - 1);
+    writeU64(fs, SAVE_CACHE_VERSION);
+    writeU64(fs, entries.size());
+    for (const auto &[key, entry] : entries) {
+        writeStr(fs, key);
+        writeU64(fs, entry.size);
+        writeU64(fs, static_cast<unsigned long long>(entry.time));
+        writeStr(fs, entry.info.charName);
+        writeStr(fs, entry.info.charHouse);
+        writeStr(fs, entry.info.saveType);
+        writeU64(fs, entry.info.dbOffset);
+        writeU64(fs, entry.info.dbSize);
+    }
+    fs.close();
+    std::error_code ec;
+    std::filesystem::rename(tempFile, file, ec);
+    if (ec) {
+        std::filesystem::remove(tempFile, ec);
+        return false;
+    }
+    dirty = false;
+    return true;
+}
+
+bool SaveCache::find(const std::filesystem::path &savePath, std::uintmax_t size, std::filesystem::file_time_type time, SaveInfo &info) {
+    std::string key = cacheKey(savePath);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = entries.find(key);
+    if (found == entries.end() || found->second.size != size || found->second.time != timeToTicks(time)) return false;
+    found->second.used = true;
+    info = found->second.info;
+    return true;
+}
+
+void SaveCache::insert(const std::filesystem::path &savePath, std::uintmax_t size, std::filesystem::file_time_type time, const SaveInfo &info) {
+    std::string key = cacheKey(savePath);
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[key] = {size, timeToTicks(time), info, true};
+    dirty = true;
+}
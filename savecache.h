@@ -0,0 +1,52 @@
+#ifndef LEGILIMENS_HOGWARTS_LEGACY_CPP_SAVECACHE_H
+#define LEGILIMENS_HOGWARTS_LEGACY_CPP_SAVECACHE_H
+
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#define SAVE_CACHE_FILE "legilimens-cache.bin"
+#define SAVE_CACHE_MAGIC "LGMNSCACHE"
+// 2: caches written by version 1 can have the name, house or database location of another save
+#define SAVE_CACHE_VERSION 2
+
+// Metadata read from a save file
+struct SaveInfo {
+    std::string charName;
+    std::string charHouse;
+    std::string saveType;
+    unsigned long long dbOffset = 0; // Offset of the database contained in the save, 0 if it wasn't found
+    unsigned long long dbSize = 0;
+};
+
+// On-disk cache of save metadata, keyed by path, size and last write time, so unchanged saves don't have to be reread
+// Lookups and inserts are safe to make from several threads at once
+class SaveCache {
+public:
+    SaveCache() = default;
+    explicit SaveCache(std::filesystem::path file) : file(std::move(file)) {}
+
+    // Loads the cache file, and returns whether it was successful. A missing or outdated file leaves the cache empty
+    bool load();
+    // Writes the cache file if anything changed, dropping saves that weren't used since it was loaded
+    bool write();
+    // Sets info to the cached metadata for a save, and returns whether it was cached and hasn't changed since
+    bool find(const std::filesystem::path &savePath, std::uintmax_t size, std::filesystem::file_time_type time, SaveInfo &info);
+    void insert(const std::filesystem::path &savePath, std::uintmax_t size, std::filesystem::file_time_type time, const SaveInfo &info);
+
+private:
+    struct Entry {
+        std::uintmax_t size;
+        long long time;
+        SaveInfo info;
+        bool used;
+    };
+
+    std::filesystem::path file;
+    std::unordered_map<std::string, Entry> entries;
+    bool dirty = false;
+    std::mutex mutex;
+};
+
+#endif //LEGILIMENS_HOGWARTS_LEGACY_CPP_SAVECACHE_H
@@ -0,0 +1,128 @@
+#include "savefile.h"
+#include <algorithm>
+#include <utility>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+SaveFile::SaveFile(SaveFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+SaveFile &SaveFile::operator=(SaveFile &&other) noexcept {
+    if (this == &other) return *this;
+    close();
+    bool buffered = !other.buffer.empty() && other.bytes.data() == other.buffer.data();
+    buffer = std::move(other.buffer);
+    bytes = buffered ? std::string_view(buffer) : other.bytes;
+    totalSize = other.totalSize;
+    mapped = std::exchange(other.mapped, nullptr);
+#ifdef _WIN32
+    fileHandle = std::exchange(other.fileHandle, nullptr);
+    mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#else
+    fd = std::exchange(other.fd, -1);
+#endif
+    other.close();
+    return *this;
+}
+
+SaveFile::~SaveFile() {
+    close();
+}
+
+bool SaveFile::open(const std::filesystem::path &path, std::size_t maxBytes) {
+    close();
+    std::error_code ec;
+    totalSize = std::filesystem::file_size(path, ec);
+    if (ec) return false;
+    std::size_t length = std::min<std::uintmax_t>(totalSize, maxBytes);
+#ifdef _WIN32
+    fileHandle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        fileHandle = nullptr;
+        return false;
+    }
+#else
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+#endif
+    if (length == 0 || map(length) || readAll(length)) return true;
+    close();
+    return false;
+}
+
+void SaveFile::assign(std::string newBytes) {
+    close();
+    buffer = std::move(newBytes);
+    bytes = buffer;
+    totalSize = buffer.size();
+}
+
+void SaveFile::close() {
+#ifdef _WIN32
+    if (mapped) UnmapViewOfFile(mapped);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (mapped) munmap(mapped, bytes.size());
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+#endif
+    mapped = nullptr;
+    bytes = {};
+    buffer.clear();
+    buffer.shrink_to_fit();
+    totalSize = 0;
+}
+
+// Maps the first length bytes of the open file, and returns whether it was successful
+bool SaveFile::map(std::size_t length) {
+#ifdef _WIN32
+    mappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr) return false;
+    mapped = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, length);
+    if (mapped == nullptr) {
+        CloseHandle(mappingHandle);
+        mappingHandle = nullptr;
+        return false;
+    }
+#else
+    void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) return false;
+    madvise(address, length, MADV_SEQUENTIAL);
+    mapped = address;
+#endif
+    bytes = std::string_view(static_cast<const char *>(mapped), length);
+    return true;
+}
+
+// Reads the first length bytes of the open file into the buffer in chunks, and returns whether it was successful
+bool SaveFile::readAll(std::size_t length) {
+    buffer.resize(length);
+    std::size_t offset = 0;
+    while (offset < length) {
+        std::size_t chunk = std::min<std::size_t>(length - offset, SAVE_READ_CHUNK_SIZE);
+#ifdef _WIN32
+        OVERLAPPED position = {};
+        position.Offset = static_cast<DWORD>(offset);
+        position.OffsetHigh = static_cast<DWORD>(static_cast<unsigned long long>(offset) >> 32);
+        DWORD read = 0;
+        if (!ReadFile(fileHandle, buffer.data() + offset, static_cast<DWORD>(chunk), &read, &position) || read == 0) break;
+#else
+        ssize_t read = pread(fd, buffer.data() + offset, chunk, static_cast<off_t>(offset));
+        if (read <= 0) break;
+#endif
+        offset += read;
+    }
+    // The file may have shrunk since its size was checked
+    buffer.resize(offset);
+    bytes = buffer;
+    return offset > 0;
+}
@@ -0,0 +1,51 @@
+#ifndef LEGILIMENS_HOGWARTS_LEGACY_CPP_SAVEFILE_H
+#define LEGILIMENS_HOGWARTS_LEGACY_CPP_SAVEFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+#define SAVE_READ_CHUNK_SIZE (1 << 20)
+
+// Read-only view over the bytes of a save file. The file is memory mapped when possible, and otherwise read into a
+// single buffer with positional reads. Either way the bytes are never copied again, and stay valid until closed
+class SaveFile {
+public:
+    SaveFile() = default;
+    SaveFile(const SaveFile &) = delete;
+    SaveFile &operator=(const SaveFile &) = delete;
+    SaveFile(SaveFile &&other) noexcept;
+    SaveFile &operator=(SaveFile &&other) noexcept;
+    ~SaveFile();
+
+    // Opens the first maxBytes of path (or all of it), and returns whether it was successful
+    bool open(const std::filesystem::path &path, std::size_t maxBytes = SIZE_MAX);
+    // Uses bytes that are already in memory instead of a file
+    void assign(std::string bytes);
+    void close();
+
+    [[nodiscard]] std::string_view data() const { return bytes; }
+    [[nodiscard]] std::size_t size() const { return bytes.size(); }
+    // Size of the whole file, which is bigger than size() if only part of it was opened
+    [[nodiscard]] std::uintmax_t fileSize() const { return totalSize; }
+    [[nodiscard]] bool isMapped() const { return mapped != nullptr; }
+
+private:
+    bool map(std::size_t length);
+    bool readAll(std::size_t length);
+
+    std::string_view bytes;
+    std::string buffer;
+    std::uintmax_t totalSize = 0;
+    void *mapped = nullptr;
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+#endif //LEGILIMENS_HOGWARTS_LEGACY_CPP_SAVEFILE_H
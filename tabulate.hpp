@@ -5649,6 +5649,13 @@ nssv_RESTORE_WARNINGS()
 #error unsupported platform
 #endif
 
+// Colors are written as ANSI escape sequences everywhere but on Windows, where the console API is used
+// unless TERMCOLOR_USE_ANSI_ESCAPE_SEQUENCES is defined. Escape sequences can be written to any stream,
+// e.g. a std::stringstream marked with colorize, while the console API only works for the console
+#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX) || defined(TERMCOLOR_USE_ANSI_ESCAPE_SEQUENCES)
+#define TERMCOLOR_TARGET_ANSI
+#endif
+
 // This headers provides the `isatty()`/`fileno()` functions,
 // which are used for testing whether a standart stream refers
 // to the terminal. As for Windows, we also need WinApi funcs
@@ -5669,7 +5676,9 @@ namespace termcolor {
 namespace _internal {
 // An index to be used to access a private storage of I/O streams. See
 // colorize / nocolorize I/O manipulators for details.
-static int colorize_index = std::ios_base::xalloc();
+// It's inline so every translation unit agrees on it, otherwise a stream
+// marked with colorize in one isn't colorized by another.
+inline int colorize_index = std::ios_base::xalloc();
 
 inline FILE *get_standard_stream(const std::ostream &stream);
 inline bool is_colorized(std::ostream &stream);
@@ -5692,7 +5701,7 @@ inline std::ostream &nocolorize(std::ostream &stream) {
 
 inline std::ostream &reset(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[00m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
     _internal::win_change_attributes(stream, -1, -1);
@@ -5703,7 +5712,7 @@ inline std::ostream &reset(std::ostream &stream) {
 
 inline std::ostream &bold(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[1m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
 #endif
@@ -5713,7 +5722,7 @@ inline std::ostream &bold(std::ostream &stream) {
 
 inline std::ostream &dark(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[2m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
 #endif
@@ -5723,7 +5732,7 @@ inline std::ostream &dark(std::ostream &stream) {
 
 inline std::ostream &italic(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[3m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
 #endif
@@ -5733,7 +5742,7 @@ inline std::ostream &italic(std::ostream &stream) {
 
 inline std::ostream &underline(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[4m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
 #endif
@@ -5743,7 +5752,7 @@ inline std::ostream &underline(std::ostream &stream) {
 
 inline std::ostream &blink(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[5m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
 #endif
@@ -5753,7 +5762,7 @@ inline std::ostream &blink(std::ostream &stream) {
 
 inline std::ostream &reverse(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[7m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
 #endif
@@ -5763,7 +5772,7 @@ inline std::ostream &reverse(std::ostream &stream) {
 
 inline std::ostream &concealed(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[8m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
 #endif
@@ -5773,7 +5782,7 @@ inline std::ostream &concealed(std::ostream &stream) {
 
 inline std::ostream &crossed(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[9m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
 #endif
@@ -5783,7 +5792,7 @@ inline std::ostream &crossed(std::ostream &stream) {
 
 inline std::ostream &grey(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[30m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
     _internal::win_change_attributes(stream,
@@ -5796,7 +5805,7 @@ inline std::ostream &grey(std::ostream &stream) {
 
 inline std::ostream &red(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[31m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
     _internal::win_change_attributes(stream, FOREGROUND_RED);
@@ -5807,7 +5816,7 @@ inline std::ostream &red(std::ostream &stream) {
 
 inline std::ostream &green(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[32m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
     _internal::win_change_attributes(stream, FOREGROUND_GREEN);
@@ -5818,7 +5827,7 @@ inline std::ostream &green(std::ostream &stream) {
 
 inline std::ostream &yellow(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[33m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
     _internal::win_change_attributes(stream, FOREGROUND_GREEN | FOREGROUND_RED);
@@ -5829,7 +5838,7 @@ inline std::ostream &yellow(std::ostream &stream) {
 
 inline std::ostream &blue(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[34m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
     _internal::win_change_attributes(stream, FOREGROUND_BLUE);
@@ -5840,7 +5849,7 @@ inline std::ostream &blue(std::ostream &stream) {
 
 inline std::ostream &magenta(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[35m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
     _internal::win_change_attributes(stream, FOREGROUND_BLUE | FOREGROUND_RED);
@@ -5851,7 +5860,7 @@ inline std::ostream &magenta(std::ostream &stream) {
 
 inline std::ostream &cyan(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[36m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
     _internal::win_change_attributes(stream, FOREGROUND_BLUE | FOREGROUND_GREEN);
@@ -5862,7 +5871,7 @@ inline std::ostream &cyan(std::ostream &stream) {
 
 inline std::ostream &white(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[37m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
     _internal::win_change_attributes(stream, FOREGROUND_BLUE | FOREGROUND_GREEN | FOREGROUND_RED);
@@ -5873,7 +5882,7 @@ inline std::ostream &white(std::ostream &stream) {
 
 inline std::ostream &on_grey(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[40m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
     _internal::win_change_attributes(stream, -1,
@@ -5886,7 +5895,7 @@ inline std::ostream &on_grey(std::ostream &stream) {
 
 inline std::ostream &on_red(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[41m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
     _internal::win_change_attributes(stream, -1, BACKGROUND_RED);
@@ -5897,7 +5906,7 @@ inline std::ostream &on_red(std::ostream &stream) {
 
 inline std::ostream &on_green(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[42m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
     _internal::win_change_attributes(stream, -1, BACKGROUND_GREEN);
@@ -5908,7 +5917,7 @@ inline std::ostream &on_green(std::ostream &stream) {
 
 inline std::ostream &on_yellow(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[43m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
     _internal::win_change_attributes(stream, -1, BACKGROUND_GREEN | BACKGROUND_RED);
@@ -5919,7 +5928,7 @@ inline std::ostream &on_yellow(std::ostream &stream) {
 
 inline std::ostream &on_blue(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[44m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
     _internal::win_change_attributes(stream, -1, BACKGROUND_BLUE);
@@ -5930,7 +5939,7 @@ inline std::ostream &on_blue(std::ostream &stream) {
 
 inline std::ostream &on_magenta(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[45m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
     _internal::win_change_attributes(stream, -1, BACKGROUND_BLUE | BACKGROUND_RED);
@@ -5941,7 +5950,7 @@ inline std::ostream &on_magenta(std::ostream &stream) {
 
 inline std::ostream &on_cyan(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[46m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
     _internal::win_change_attributes(stream, -1, BACKGROUND_GREEN | BACKGROUND_BLUE);
@@ -5952,7 +5961,7 @@ inline std::ostream &on_cyan(std::ostream &stream) {
 
 inline std::ostream &on_white(std::ostream &stream) {
   if (_internal::is_colorized(stream)) {
-#if defined(TERMCOLOR_OS_MACOS) || defined(TERMCOLOR_OS_LINUX)
+#if defined(TERMCOLOR_TARGET_ANSI)
     stream << "\033[47m";
 #elif defined(TERMCOLOR_OS_WINDOWS)
     _internal::win_change_attributes(stream, -1,
@@ -6067,6 +6076,7 @@ inline void win_change_attributes(std::ostream &stream, int foreground, int back
 #undef TERMCOLOR_OS_WINDOWS
 #undef TERMCOLOR_OS_MACOS
 #undef TERMCOLOR_OS_LINUX
+#undef TERMCOLOR_TARGET_ANSI
 
 #endif // TERMCOLOR_HPP_
 
@@ -0,0 +1,38 @@
+#ifndef LEGILIMENS_HOGWARTS_LEGACY_CPP_TOKENS_H
+#define LEGILIMENS_HOGWARTS_LEGACY_CPP_TOKENS_H
+
+#include <string_view>
+
+// Characters matched by the regex \w in the "C" locale
+inline bool isWordChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// Characters matched by the regex \d
+inline bool isDigitChar(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Splits text into the runs of characters that satisfy isTokenChar, like iterating over the matches of \w+ or \d+,
+// without allocating. Tokens are views into text, so they're only valid as long as it is
+class Tokenizer {
+public:
+    Tokenizer(std::string_view text, bool (*isTokenChar)(char)) : text(text), isTokenChar(isTokenChar) {}
+
+    // Gets the next token, and returns false once there are none left
+    bool next(std::string_view &token) {
+        while (pos < text.length() && !isTokenChar(text[pos])) pos++;
+        if (pos == text.length()) return false;
+        std::size_t start = pos;
+        while (pos < text.length() && isTokenChar(text[pos])) pos++;
+        token = text.substr(start, pos - start);
+        return true;
+    }
+
+private:
+    std::string_view text;
+    bool (*isTokenChar)(char);
+    std::size_t pos = 0;
+};
+
+#endif //LEGILIMENS_HOGWARTS_LEGACY_CPP_TOKENS_H
@@ -0,0 +1,34 @@
+#ifndef LEGILIMENS_HOGWARTS_LEGACY_CPP_WORKERS_H
+#define LEGILIMENS_HOGWARTS_LEGACY_CPP_WORKERS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Number of workers to use when the work is CPU bound
+inline unsigned int defaultWorkerCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Runs task(i) for every i in [0, count) on a pool of at most maxWorkers threads, and waits for all of them to finish
+// Tasks are handed out in order, so writing task(i)'s result to slot i of a presized vector keeps results in order
+template <typename Task>
+void runParallel(std::size_t count, unsigned int maxWorkers, Task &&task) {
+    std::size_t workerCount = std::min<std::size_t>(std::max(1u, maxWorkers), count);
+    if (workerCount <= 1) {
+        for (std::size_t i = 0; i < count; i++) task(i);
+        return;
+    }
+    std::atomic<std::size_t> next = 0;
+    auto work = [&] {
+        for (std::size_t i = next++; i < count; i = next++) task(i);
+    };
+    std::vector<std::jthread> workers;
+    workers.reserve(workerCount - 1);
+    for (std::size_t i = 1; i < workerCount; i++) workers.emplace_back(work);
+    work();
+}
+
+#endif //LEGILIMENS_HOGWARTS_LEGACY_CPP_WORKERS_H